@@ -1,6 +1,16 @@
 // main.cpp
 // Console Snake game with a start-screen and "typewriter" code-writing animation.
 // Controls: WASD or Arrow keys. Press 'q' to quit.
+// Run with --autopilot [greedy|expectimax|neural] to let a bot steer,
+// --boundary walls|portals for a board with edges, --train to evolve neural
+// controllers headless, --log-dataset FILE to record play for imitation
+// learning, --analyze for statistics and heatmaps over many bot games,
+// --host-socket PATH / --host-ptys N to serve many kiosk terminals from one
+// process, --duel-host PATH / --duel-join PATH for two players, or --bench
+// to time the game's hot paths without a terminal. --telemetry NAME
+// publishes per-tick metrics for snake_monitor (snake_monitor.cpp), and
+// --autosave FILE resumes a game interrupted by a crash.
+// Build: g++ -std=c++20 -O2 -pthread snake_game.cpp -o snake_game
 
 #include <iostream>
 #include <vector>
@@ -10,23 +20,63 @@
 #include <random>
 #include <atomic>
 #include <string>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+#include <iomanip>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <mutex>
+#include <condition_variable>
+#include <cmath>
+#include <cstddef>
+#include <cerrno>
+#include <coroutine>
+#include <utility>
 
 #ifdef _WIN32
   #include <conio.h>
+  #include <io.h>
   #include <windows.h>
 #else
   #include <termios.h>
   #include <unistd.h>
   #include <sys/select.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <csignal>
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #include <sys/resource.h>
+  #if defined(__GLIBC__)
+    #include <malloc.h>
+  #endif
+  #if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define SNAKE_HAVE_IO_URING 1
+    #include <linux/io_uring.h>
+    #include <sys/syscall.h>
+  #endif
 #endif
 
+#include "snake_telemetry.h"
+
 using namespace std;
 
 constexpr int WIDTH = 30;
 constexpr int HEIGHT = 20;
+constexpr int MAX_FOOD = WIDTH * HEIGHT / 4; // --food; more would leave the snake no room
 constexpr char SNAKE_CHAR = 'O';
 constexpr char FOOD_CHAR = '*';
 constexpr char EMPTY_CHAR = ' ';
+constexpr char BONUS_CHAR = '$';
+constexpr char SLOW_CHAR = '~';
 
 enum class Direction { UP, DOWN, LEFT, RIGHT };
 
@@ -36,346 +86,5196 @@ struct Point {
     bool operator==(const Point& o) const { return x == o.x && y == o.y; }
 };
 
-#ifdef _WIN32
-void enableANSI() {
-    // Enable ANSI escape codes on Windows 10+
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (hOut == INVALID_HANDLE_VALUE) return;
-    DWORD dwMode = 0;
-    if (!GetConsoleMode(hOut, &dwMode)) return;
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    SetConsoleMode(hOut, dwMode);
+// ---------- Board geometry ----------
+// Cells are numbered y * W + x. For every cell and Direction the table holds
+// the neighbouring cell, so a snake step is one load instead of a switch plus
+// four edge checks. Pathfinding uses the same table.
+
+template <int W, int H>
+using CellIndex = std::conditional_t<(W * H <= 0xFFFF), uint16_t, uint32_t>;
+
+// Boundary policies, chosen per game type at compile time. A policy only
+// decides which edges can be crossed; a move through a closed edge leads
+// back to the cell itself, which is the snake's own head, so the step sees a
+// collision without any mode check. edgeOpen(along, length) is asked for the
+// position along the edge being crossed.
+struct WrapAround {
+    static constexpr bool TORUS = true;
+    static constexpr const char* NAME = "wrap";
+    static constexpr bool edgeOpen(int, int) { return true; }
+};
+
+struct SolidWalls {
+    static constexpr bool TORUS = false;
+    static constexpr const char* NAME = "walls";
+    static constexpr bool edgeOpen(int, int) { return false; }
+};
+
+// Walls with the middle third of every edge open, leading to the opposite side.
+struct Portals {
+    static constexpr bool TORUS = false;
+    static constexpr const char* NAME = "portals";
+    static constexpr bool edgeOpen(int along, int length) { return along >= length / 3 && along < length - length / 3; }
+};
+
+template <int W, int H, typename B = WrapAround>
+struct NeighborTable {
+    CellIndex<W, H> next[4][W * H]; // indexed by Direction, then cell
+};
+
+template <int W, int H, typename B>
+constexpr void fillNeighborTable(NeighborTable<W, H, B>& t) {
+    using Cell = CellIndex<W, H>;
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            int c = y * W + x;
+            bool openV = B::edgeOpen(x, W), openH = B::edgeOpen(y, H);
+            t.next[static_cast<int>(Direction::UP)][c] = Cell((y > 0 || openV) ? ((y + H - 1) % H) * W + x : c);
+            t.next[static_cast<int>(Direction::DOWN)][c] = Cell((y < H - 1 || openV) ? ((y + 1) % H) * W + x : c);
+            t.next[static_cast<int>(Direction::LEFT)][c] = Cell((x > 0 || openH) ? y * W + (x + W - 1) % W : c);
+            t.next[static_cast<int>(Direction::RIGHT)][c] = Cell((x < W - 1 || openH) ? y * W + (x + 1) % W : c);
+        }
+    }
 }
-#endif
 
-// ---------- Non-blocking keyboard input helpers ----------
-#ifdef _WIN32
-bool kbhit_nonblock() {
-    return _kbhit();
+template <int W, int H, typename B>
+constexpr NeighborTable<W, H, B> makeNeighborTable() {
+    NeighborTable<W, H, B> t{};
+    fillNeighborTable(t);
+    return t;
 }
-int getch_nonblock() {
-    if (_kbhit()) {
-        return _getch();
+
+// Boards up to this many cells get their table at compile time; larger ones
+// (benchmarks, giant boards) build it once on first use.
+constexpr int COMPILE_TIME_TABLE_CELLS = 4096;
+
+template <int W, int H, typename B = WrapAround>
+const NeighborTable<W, H, B>& neighborTable() {
+    if constexpr (W * H <= COMPILE_TIME_TABLE_CELLS) {
+        static constexpr NeighborTable<W, H, B> table = makeNeighborTable<W, H, B>();
+        return table;
+    } else {
+        static const std::unique_ptr<NeighborTable<W, H, B>> table = [] {
+            auto t = std::make_unique<NeighborTable<W, H, B>>();
+            fillNeighborTable(*t);
+            return t;
+        }();
+        return *table;
     }
-    return -1;
-}
-#else
-// POSIX: implement kbhit and getch-like behavior
-static struct termios orig_termios;
-void reset_terminal_mode() {
-    tcsetattr(0, TCSANOW, &orig_termios);
 }
-void set_conio_terminal_mode() {
-    struct termios new_termios;
-    tcgetattr(0, &orig_termios);
-    new_termios = orig_termios;
-    // disable canonical mode, and set buffer size to 1 byte
-    new_termios.c_lflag &= ~(ICANON | ECHO);
-    new_termios.c_cc[VMIN] = 0;
-    new_termios.c_cc[VTIME] = 0;
-    tcsetattr(0, TCSANOW, &new_termios);
-    atexit(reset_terminal_mode);
+
+// ---------- Occupancy bitset and flood fill ----------
+// One bit per cell, rows padded to whole 64-bit words.
+template <int W, int H>
+struct BitGrid {
+    static constexpr int WORDS = (W + 63) / 64; // words per row
+    static constexpr uint64_t LAST_WORD_MASK = (W % 64) ? (1ULL << (W % 64)) - 1 : ~0ULL;
+    std::array<uint64_t, H * WORDS> bits{};
+
+    uint64_t* row(int y) { return &bits[y * WORDS]; }
+    const uint64_t* row(int y) const { return &bits[y * WORDS]; }
+    bool test(int c) const { return (bits[index(c)] >> ((c % W) % 64)) & 1; }
+    void set(int c) { bits[index(c)] |= 1ULL << ((c % W) % 64); }
+    void reset(int c) { bits[index(c)] &= ~(1ULL << ((c % W) % 64)); }
+    void clear() { bits.fill(0); }
+    int count() const {
+        int n = 0;
+        for (uint64_t w : bits) n += __builtin_popcountll(w);
+        return n;
+    }
+
+private:
+    static int index(int c) { return (c / W) * WORDS + (c % W) / 64; }
+};
+
+// Kogge-Stone occluded fills: spread the bits of g through the set bits of p
+// towards higher (left) or lower (right) bit positions, 6 steps per word.
+inline uint64_t fillLeft(uint64_t g, uint64_t p) {
+    g |= p & (g << 1);  p &= p << 1;
+    g |= p & (g << 2);  p &= p << 2;
+    g |= p & (g << 4);  p &= p << 4;
+    g |= p & (g << 8);  p &= p << 8;
+    g |= p & (g << 16); p &= p << 16;
+    return g | (p & (g << 32));
 }
-bool kbhit_nonblock() {
-    fd_set set;
-    struct timeval tv;
-    FD_ZERO(&set);
-    FD_SET(0, &set);
-    tv.tv_sec = 0;
-    tv.tv_usec = 0;
-    return select(1, &set, nullptr, nullptr, &tv) > 0;
-}
-int getch_nonblock() {
-    unsigned char ch;
-    if (read(0, &ch, 1) == 1) return ch;
-    return -1;
+inline uint64_t fillRight(uint64_t g, uint64_t p) {
+    g |= p & (g >> 1);  p &= p >> 1;
+    g |= p & (g >> 2);  p &= p >> 2;
+    g |= p & (g >> 4);  p &= p >> 4;
+    g |= p & (g >> 8);  p &= p >> 8;
+    g |= p & (g >> 16); p &= p >> 16;
+    return g | (p & (g >> 32));
 }
-#endif
 
-// ---------- Utility functions ----------
-void clear_screen() {
-    // Use ANSI escape to clear screen and move cursor to home.
-    std::cout << "\x1B[2J\x1B[H";
+// Fills a row to its fixpoint: within words, across word boundaries, and
+// around the wrapped left/right edge.
+template <int W, int H>
+void spreadRow(uint64_t* r, const uint64_t* f) {
+    constexpr int N = BitGrid<W, H>::WORDS;
+    constexpr int LAST = (W - 1) % 64;
+    while (true) {
+        for (int w = 0; w < N; ++w) r[w] = fillRight(fillLeft(r[w], f[w]), f[w]);
+        bool grew = false;
+        auto seed = [&](int w, uint64_t bit) {
+            if ((f[w] & bit) && !(r[w] & bit)) { r[w] |= bit; grew = true; }
+        };
+        for (int w = 0; w + 1 < N; ++w) {
+            if (r[w] >> 63) seed(w + 1, 1);
+            if (r[w + 1] & 1) seed(w, 1ULL << 63);
+        }
+        if ((r[N - 1] >> LAST) & 1) seed(0, 1);
+        if (r[0] & 1) seed(N - 1, 1ULL << LAST);
+        if (!grew) return;
+    }
 }
 
-void sleep_ms(int ms) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+// Plain BFS over the neighbour table; works for any boundary policy.
+template <int W, int H, typename B = WrapAround>
+int reachableAreaBfs(const BitGrid<W, H>& occupied, int start, BitGrid<W, H>* reachedOut = nullptr) {
+    const auto& table = neighborTable<W, H, B>();
+    std::vector<uint8_t> seen(W * H, 0);
+    std::vector<int> queue;
+    queue.reserve(W * H);
+    queue.push_back(start);
+    seen[start] = 1;
+    for (size_t i = 0; i < queue.size(); ++i) {
+        for (int d = 0; d < 4; ++d) {
+            int n = table.next[d][queue[i]];
+            if (!seen[n] && !occupied.test(n)) { seen[n] = 1; queue.push_back(n); }
+        }
+    }
+    if (reachedOut) {
+        reachedOut->clear();
+        for (size_t i = 1; i < queue.size(); ++i) reachedOut->set(queue[i]);
+    }
+    return (int)queue.size() - 1;
 }
 
-// Print text with typewriter effect (character-by-character)
-void typeEffect(const string &s, int ms_per_char = 30) {
-    for (char c : s) {
-        cout << c << flush;
-        sleep_ms(ms_per_char);
+// Number of free cells reachable from `start`, not counting start itself
+// (normally the snake's head). On the wrap-around board the reached set
+// grows by word-wide shift/OR dilation: each row update ORs in the rows above
+// and below (a straight word loop the compiler vectorizes) and then fills
+// along the row. Sweeps alternate downwards and upwards and only revisit rows
+// next to one that grew, until nothing changes. Bounded boards use the BFS.
+template <int W, int H, typename B = WrapAround>
+int reachableArea(const BitGrid<W, H>& occupied, int start, BitGrid<W, H>* reachedOut = nullptr) {
+    if constexpr (!B::TORUS) return reachableAreaBfs<W, H, B>(occupied, start, reachedOut);
+    constexpr int N = BitGrid<W, H>::WORDS;
+    BitGrid<W, H> freeCells, reached;
+    for (int y = 0; y < H; ++y) {
+        for (int w = 0; w < N; ++w) {
+            uint64_t mask = (w == N - 1) ? BitGrid<W, H>::LAST_WORD_MASK : ~0ULL;
+            freeCells.row(y)[w] = ~occupied.row(y)[w] & mask;
+        }
     }
-}
+    freeCells.set(start);
+    reached.set(start);
 
-// Print a centered line within board width (for intro)
-void printCentered(const string &s, int totalWidth = WIDTH + 2) {
-    int pad = max(0, (totalWidth - (int)s.size()) / 2);
-    for (int i = 0; i < pad; ++i) cout << ' ';
-    cout << s << '\n';
+    std::array<bool, H> dirty{};
+    auto sweepRow = [&](int y) {
+        if (!dirty[y]) return false;
+        dirty[y] = false;
+        uint64_t* r = reached.row(y);
+        const uint64_t* up = reached.row((y + H - 1) % H);
+        const uint64_t* down = reached.row((y + 1) % H);
+        const uint64_t* f = freeCells.row(y);
+        uint64_t before[N], diff = 0;
+        for (int w = 0; w < N; ++w) {
+            before[w] = r[w];
+            r[w] |= (up[w] | down[w]) & f[w];
+        }
+        spreadRow<W, H>(r, f);
+        for (int w = 0; w < N; ++w) diff |= r[w] ^ before[w];
+        if (!diff) return false;
+        dirty[(y + H - 1) % H] = dirty[(y + 1) % H] = true;
+        return true;
+    };
+
+    int startRow = start / W;
+    spreadRow<W, H>(reached.row(startRow), freeCells.row(startRow));
+    dirty[(startRow + H - 1) % H] = dirty[(startRow + 1) % H] = true;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int y = 0; y < H; ++y) changed |= sweepRow(y);
+        for (int y = H - 1; y >= 0; --y) changed |= sweepRow(y);
+    }
+    reached.reset(start);
+    if (reachedOut) *reachedOut = reached;
+    return reached.count();
 }
 
-// ---------- Game class ----------
-class SnakeGame {
+// ---------- Distance field ----------
+// BFS distance from every free cell to the food, through free cells. It is
+// rebuilt only when the food moves; a body cell appearing or disappearing
+// patches just the cells whose distance actually changes, so a bot can read
+// its next move off the field in O(1) on most ticks.
+template <int W, int H, typename B = WrapAround>
+class DistanceField {
 public:
-    SnakeGame()
-    : dir(Direction::RIGHT), score(0), gameOver(false), rng(rd()), playerName("Player") {
-        reset();
-    }
+    static constexpr int32_t UNREACHABLE = INT32_MAX;
 
-    void reset() {
-        board.assign(HEIGHT, std::string(WIDTH, EMPTY_CHAR));
-        snake.clear();
-        // start snake in middle
-        Point mid{WIDTH / 2, HEIGHT / 2};
-        snake.push_back(mid);
-        // initial length 3
-        snake.push_back({mid.x - 1, mid.y});
-        snake.push_back({mid.x - 2, mid.y});
-        dir = Direction::RIGHT;
-        placeFood();
-        score = 0;
-        gameOver = false;
-    }
+    DistanceField() : neighbors(neighborTable<W, H, B>()), dist(W * H, UNREACHABLE) {}
 
-    // Show start-screen with ASCII title, ask for name, and show "typing code" animation
-    void showIntro() {
-#ifdef _WIN32
-        enableANSI();
-#endif
-        clear_screen();
-        cout << "\n";
-        printCentered("+-------------------------------------------+");
-        printCentered("|                                           |");
-        printCentered("|               S N A K E   G A M E         |");
-        printCentered("|                                           |");
-        printCentered("+-------------------------------------------+");
-        cout << "\n";
-        printCentered("A pure C++ console game. Controls: WASD or Arrow keys.");
-        cout << "\n";
-        cout << "Enter your name (press Enter to accept): ";
-        string name;
-        getline(cin, name);
-        if (!name.empty()) playerName = name;
-        cout << "\n";
-        printCentered("Preparing game...");
-        sleep_ms(400);
+    int32_t at(int cell) const { return dist[cell]; }
 
-        // Typewriter "code writing" effect - small fake code snippet to simulate typing
-        vector<string> fakeCode = {
-            "int main() {",
-            "    // initializing game engine",
-            "    SnakeGame game;",
-            "    game.run();",
-            "    return 0;",
-            "}"
-        };
-        cout << "\n";
-        for (const auto &line : fakeCode) {
-            printCentered(""); // blank line spacing
-            // indent a bit
-            cout << "    ";
-            typeEffect(line, 25);
-            cout << "\n";
-            sleep_ms(220);
-        }
-        cout << "\n";
-        printCentered("Press any key to start...");
-        // wait for any key press (blocking until a key)
-#ifdef _WIN32
-        while (!_kbhit()) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }
-        // consume key
-        _getch();
-#else
-        // On POSIX, just wait until a key is pressed
-        set_conio_terminal_mode();
-        while (!kbhit_nonblock()) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }
-        // consume the key
-        getch_nonblock();
-        reset_terminal_mode(); // restore so input line is clean
-#endif
-        clear_screen();
+    void rebuild(const BitGrid<W, H>& occupied, int food) {
+        source = food;
+        std::fill(dist.begin(), dist.end(), UNREACHABLE);
+        dist[food] = 0;
+        queue.clear();
+        queue.push_back(food);
+        relaxFrom(occupied, 0);
     }
 
-    void run() {
-#ifdef _WIN32
-        enableANSI();
-#else
-        set_conio_terminal_mode();
-#endif
-        using clock = std::chrono::steady_clock;
-        auto last_update = clock::now();
-        int speed_ms = 120; // lower = faster
+    // Call after `cell` has been set in `occupied`. Distances can only grow:
+    // cells that relied on `cell` (and nothing else) for their shortest path
+    // are invalidated level by level, then re-derived from their valid
+    // neighbours in distance order.
+    void cellBlocked(const BitGrid<W, H>& occupied, int cell) {
+        int32_t old = dist[cell];
+        dist[cell] = UNREACHABLE;
+        if (old == UNREACHABLE || cell == source) return; // a new food means a rebuild anyway
 
-        while (!gameOver) {
-            handleInput();
-            auto now = clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update).count();
-            if (elapsed >= speed_ms) {
-                update();
-                draw();
-                last_update = now;
+        invalid.clear();
+        queue.clear();
+        forEachFreeNeighbor(occupied, cell, [&](int n) { if (dist[n] == old + 1) queue.push_back(n); });
+        for (size_t i = 0; i < queue.size(); ++i) {
+            int u = queue[i];
+            int32_t du = dist[u];
+            if (du == UNREACHABLE) continue;
+            bool supported = false;
+            forEachFreeNeighbor(occupied, u, [&](int n) { supported |= (dist[n] == du - 1); });
+            if (supported) continue;
+            dist[u] = UNREACHABLE;
+            invalid.push_back(u);
+            forEachFreeNeighbor(occupied, u, [&](int n) { if (dist[n] == du + 1) queue.push_back(n); });
+        }
+
+        seeds.clear();
+        for (int u : invalid) {
+            int32_t best = UNREACHABLE;
+            forEachFreeNeighbor(occupied, u, [&](int n) { if (dist[n] != UNREACHABLE) best = std::min(best, dist[n] + 1); });
+            if (best != UNREACHABLE) seeds.push_back({best, u});
+        }
+        std::sort(seeds.begin(), seeds.end());
+        // Merge the sorted seeds with a BFS queue so cells settle in distance order.
+        queue.clear();
+        size_t head = 0, next = 0;
+        while (next < seeds.size() || head < queue.size()) {
+            int u;
+            if (head < queue.size() && (next == seeds.size() || dist[queue[head]] <= seeds[next].first)) {
+                u = queue[head++];
+            } else {
+                u = seeds[next].second;
+                int32_t d = seeds[next++].first;
+                if (dist[u] <= d) continue;
+                dist[u] = d;
             }
-            sleep_ms(5);
+            forEachFreeNeighbor(occupied, u, [&](int n) {
+                if (dist[u] + 1 < dist[n]) { dist[n] = dist[u] + 1; queue.push_back(n); }
+            });
         }
-        draw();
-        cout << "\nGame Over! " << playerName << "'s Score: " << score << "\n";
     }
 
-    void setPlayerName(const string &n) { if (!n.empty()) playerName = n; }
+    // Call after `cell` has been cleared in `occupied`. Distances can only shrink.
+    void cellFreed(const BitGrid<W, H>& occupied, int cell) {
+        int32_t best = (cell == source) ? 0 : UNREACHABLE;
+        forEachFreeNeighbor(occupied, cell, [&](int n) { if (dist[n] != UNREACHABLE) best = std::min(best, dist[n] + 1); });
+        dist[cell] = best;
+        if (best == UNREACHABLE) return;
+        queue.clear();
+        queue.push_back(cell);
+        relaxFrom(occupied, 0);
+    }
 
 private:
-    std::vector<std::string> board;
-    std::deque<Point> snake;
-    Point food;
-    Direction dir;
-    int score;
-    bool gameOver;
-    std::random_device rd;
-    std::mt19937 rng;
-    string playerName;
+    const NeighborTable<W, H, B>& neighbors;
+    std::vector<int32_t> dist;
+    std::vector<int> queue, invalid;
+    std::vector<std::pair<int32_t, int>> seeds;
+    int source = 0;
 
-    void placeFood() {
-        std::uniform_int_distribution<int> dx(0, WIDTH - 1);
-        std::uniform_int_distribution<int> dy(0, HEIGHT - 1);
-        while (true) {
-            Point p{dx(rng), dy(rng)};
-            bool onSnake = false;
-            for (auto &s : snake) if (s == p) { onSnake = true; break; }
-            if (!onSnake) { food = p; break; }
+    template <typename F>
+    void forEachFreeNeighbor(const BitGrid<W, H>& occupied, int cell, F&& f) const {
+        for (int d = 0; d < 4; ++d) {
+            int n = neighbors.next[d][cell];
+            if (!occupied.test(n)) f(n);
         }
     }
 
-    void handleInput() {
-        while (kbhit_nonblock()) {
-            int ch = getch_nonblock();
-            if (ch == -1) break;
-#ifdef _WIN32
-            // Windows: arrow keys return 0 or 224 first
-            if (ch == 0 || ch == 224) {
-                int ch2 = getch_nonblock();
-                if (ch2 == -1) break;
-                switch (ch2) {
-                    case 72: tryChangeDir(Direction::UP); break;    // up arrow
-                    case 80: tryChangeDir(Direction::DOWN); break;  // down arrow
-                    case 75: tryChangeDir(Direction::LEFT); break;  // left arrow
-                    case 77: tryChangeDir(Direction::RIGHT); break; // right arrow
-                }
-            } else {
-                handleCharInput(static_cast<char>(ch));
-            }
-#else
-            // POSIX: handle arrow keys via escape sequences or WASD
-            if (ch == 27) { // possible arrow key: ESC [
-                // attempt to read two more bytes
-                int c2 = getch_nonblock();
-                int c3 = getch_nonblock();
-                if (c2 == '[' && c3 != -1) {
-                    switch (c3) {
-                        case 'A': tryChangeDir(Direction::UP); break;
-                        case 'B': tryChangeDir(Direction::DOWN); break;
-                        case 'C': tryChangeDir(Direction::RIGHT); break;
-                        case 'D': tryChangeDir(Direction::LEFT); break;
-                    }
-                }
-            } else {
-                handleCharInput(static_cast<char>(ch));
-            }
-#endif
+    // BFS outwards from the cells in queue[start..].
+    void relaxFrom(const BitGrid<W, H>& occupied, size_t start) {
+        for (size_t i = start; i < queue.size(); ++i) {
+            int u = queue[i];
+            forEachFreeNeighbor(occupied, u, [&](int n) {
+                if (dist[u] + 1 < dist[n]) { dist[n] = dist[u] + 1; queue.push_back(n); }
+            });
         }
     }
+};
 
-    void handleCharInput(char c) {
-        c = std::tolower(c);
-        if (c == 'w') tryChangeDir(Direction::UP);
-        else if (c == 's') tryChangeDir(Direction::DOWN);
-        else if (c == 'a') tryChangeDir(Direction::LEFT);
-        else if (c == 'd') tryChangeDir(Direction::RIGHT);
-        else if (c == 'q') gameOver = true;
+// Greedy bot move: the free neighbour of `head` closest to the food, or with
+// no path to it, the free neighbour with the most reachable space.
+template <int W, int H, typename B>
+Direction greedyMove(const DistanceField<W, H, B>& field, const BitGrid<W, H>& occupied, int head, Direction current) {
+    const auto& table = neighborTable<W, H, B>();
+    int best = -1;
+    int32_t bestDist = DistanceField<W, H, B>::UNREACHABLE;
+    for (int d = 0; d < 4; ++d) {
+        int n = table.next[d][head];
+        if (!occupied.test(n) && field.at(n) < bestDist) { bestDist = field.at(n); best = d; }
     }
+    if (best >= 0) return static_cast<Direction>(best);
+    int bestArea = -1;
+    for (int d = 0; d < 4; ++d) {
+        int n = table.next[d][head];
+        if (occupied.test(n)) continue;
+        int area = reachableArea<W, H, B>(occupied, n);
+        if (area > bestArea) { bestArea = area; best = d; }
+    }
+    return best >= 0 ? static_cast<Direction>(best) : current;
+}
 
-    void tryChangeDir(Direction newDir) {
-        // prevent reversing directly
-        if ((dir == Direction::UP && newDir == Direction::DOWN) ||
-            (dir == Direction::DOWN && newDir == Direction::UP) ||
-            (dir == Direction::LEFT && newDir == Direction::RIGHT) ||
-            (dir == Direction::RIGHT && newDir == Direction::LEFT)) {
-            return;
-        }
-        dir = newDir;
+// ---------- Headless game state ----------
+// Small, fast PRNG (splitmix64). Game states are copied by bots, and an
+// mt19937 would add 5 KB to every copy.
+struct Rng {
+    uint64_t s = 0;
+
+    constexpr uint64_t next() {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    // Uniform in [0, n).
+    int below(int n) { return (int)(((next() >> 32) * (uint64_t)n) >> 32); }
+};
+
+constexpr Direction opposite(Direction d) { return static_cast<Direction>(static_cast<int>(d) ^ 1); }
+
+enum class StepResult { MOVED, ATE, DIED };
+
+// Random keys for Zobrist hashing: a position's hash is the XOR of the keys
+// of what is where, so each change costs an XOR or two instead of a pass
+// over the body. Separate keys per player for body cells, head cell and
+// direction, and one set for the food. A cell's keys sit together, so a
+// step touches two or three cache lines.
+template <int W, int H, int PLAYERS = 1>
+struct ZobristKeys {
+    struct CellKeys {
+        uint64_t body[PLAYERS], head[PLAYERS], food;
+    };
+    CellKeys cells[W * H];
+    uint64_t dirKeys[PLAYERS * 4];
+
+    constexpr uint64_t body(int player, int cell) const { return cells[cell].body[player]; }
+    constexpr uint64_t head(int player, int cell) const { return cells[cell].head[player]; }
+    constexpr uint64_t food(int cell) const { return cells[cell].food; }
+    constexpr uint64_t dir(int player, Direction d) const { return dirKeys[player * 4 + static_cast<int>(d)]; }
+};
+
+// Fixed seed, so every run (and both sides of a duel) use the same keys.
+template <int W, int H, int PLAYERS>
+constexpr void fillZobristKeys(ZobristKeys<W, H, PLAYERS>& k) {
+    Rng rng{0x2B7E151628AED2A6ULL};
+    for (auto& c : k.cells) {
+        for (int p = 0; p < PLAYERS; ++p) c.body[p] = rng.next();
+        for (int p = 0; p < PLAYERS; ++p) c.head[p] = rng.next();
+        c.food = rng.next();
+    }
+    for (uint64_t& key : k.dirKeys) key = rng.next();
+}
+
+template <int W, int H, int PLAYERS>
+constexpr ZobristKeys<W, H, PLAYERS> makeZobristKeys() {
+    ZobristKeys<W, H, PLAYERS> k{};
+    fillZobristKeys(k);
+    return k;
+}
+
+// Built like neighborTable(): at compile time for small boards.
+template <int W, int H, int PLAYERS = 1>
+const ZobristKeys<W, H, PLAYERS>& zobristKeys() {
+    if constexpr (W * H <= COMPILE_TIME_TABLE_CELLS) {
+        static constexpr ZobristKeys<W, H, PLAYERS> keys = makeZobristKeys<W, H, PLAYERS>();
+        return keys;
+    } else {
+        static const std::unique_ptr<ZobristKeys<W, H, PLAYERS>> keys = [] {
+            auto k = std::make_unique<ZobristKeys<W, H, PLAYERS>>();
+            fillZobristKeys(*k);
+            return k;
+        }();
+        return *keys;
     }
+}
 
-    void update() {
-        Point head = snake.front();
-        Point next = head;
-        switch (dir) {
-            case Direction::UP: next.y -= 1; break;
-            case Direction::DOWN: next.y += 1; break;
-            case Direction::LEFT: next.x -= 1; break;
-            case Direction::RIGHT: next.x += 1; break;
-        }
-        // wrap around (or comment this out to make walls deadly)
-        if (next.x < 0) next.x = WIDTH - 1;
-        if (next.x >= WIDTH) next.x = 0;
-        if (next.y < 0) next.y = HEIGHT - 1;
-        if (next.y >= HEIGHT) next.y = 0;
+// Everything one tick needs, in fixed-size arrays, so copying a state is a
+// flat memcpy: the body as a ring of cells, the occupancy bitset, the food,
+// the direction and the RNG. The body is ring[head], ring[head + 1], ...,
+// ring[head + length - 1] (indices mod W * H); the head moves backwards
+// through the ring so growing never shifts anything.
+template <int W, int H, typename B = WrapAround>
+struct SnakeState {
+    using Cell = CellIndex<W, H>;
+    using Boundary = B;
+    static constexpr int CELLS = W * H;
+
+    std::array<Cell, CELLS> ring{};
+    int head = 0;
+    int length = 0;
+    BitGrid<W, H> occupied;
+    Cell food = 0;
+    Direction dir = Direction::RIGHT;
+    int score = 0;
+    bool alive = true;
+    Rng rng;
+    uint64_t zobrist = 0; // body, head and food; see hash()
 
-        // check collision with self
-        for (const auto &part : snake) {
-            if (next == part) { gameOver = true; return; }
+    // Length 3 in the middle, heading right.
+    void reset(uint64_t seed) {
+        occupied.clear();
+        rng.s = seed;
+        head = 0;
+        length = 3;
+        Cell mid = Cell((H / 2) * W + W / 2);
+        for (int i = 0; i < length; ++i) {
+            ring[i] = Cell(mid - i);
+            occupied.set(ring[i]);
         }
+        dir = Direction::RIGHT;
+        score = 0;
+        alive = true;
+        placeFood();
+        zobrist = rehash() ^ keys().dir(0, dir);
+    }
 
-        // move snake
-        snake.push_front(next);
+    Cell headCell() const { return ring[head]; }
+    // i = 0 is the head, length - 1 the tail.
+    Cell bodyCell(int i) const { return ring[(head + i) % CELLS]; }
+
+    // Zobrist hash of the body cells, the head, the food and the direction,
+    // kept current by step(), grow() and placeFood(). dir is assigned
+    // directly by callers, so its key is applied here rather than stored.
+    uint64_t hash() const { return zobrist ^ keys().dir(0, dir); }
+    // The same hash from scratch, for checking.
+    uint64_t rehash() const {
+        const auto& k = keys();
+        uint64_t h = k.head(0, headCell()) ^ k.food(food) ^ k.dir(0, dir);
+        for (int i = 0; i < length; ++i) h ^= k.body(0, bodyCell(i));
+        return h;
+    }
+
+    void placeFood() {
+        while (true) {
+            Cell p = Cell(rng.below(CELLS));
+            if (!occupied.test(p)) {
+                zobrist ^= keys().food(food) ^ keys().food(p);
+                food = p;
+                return;
+            }
+        }
+    }
 
-        // check food
+    // Advances one tick in `dir`. The tail still counts as occupied when the
+    // head arrives, as it has not moved yet. On MOVED, *freed is the old tail.
+    StepResult step(Cell* freed = nullptr) {
+        Cell next = neighborTable<W, H, B>().next[static_cast<int>(dir)][ring[head]];
+        if (occupied.test(next)) {
+            alive = false;
+            return StepResult::DIED;
+        }
+        const auto& k = keys();
+        zobrist ^= k.head(0, ring[head]) ^ k.head(0, next) ^ k.body(0, next);
+        head = (head == 0) ? CELLS - 1 : head - 1;
+        ring[head] = next;
+        occupied.set(next);
         if (next == food) {
+            ++length;
             score += 10;
             placeFood();
-        } else {
-            // normal move: pop tail
-            snake.pop_back();
+            return StepResult::ATE;
         }
+        Cell tail = ring[(head + length) % CELLS];
+        occupied.reset(tail);
+        zobrist ^= k.body(0, tail);
+        if (freed) *freed = tail;
+        return StepResult::MOVED;
     }
 
-    void draw() {
-        // build board
-        for (int y = 0; y < HEIGHT; ++y) {
-            for (int x = 0; x < WIDTH; ++x) board[y][x] = EMPTY_CHAR;
+    // Right after a MOVED step: takes back the tail it released, so the snake
+    // grows as if it had eaten (for food that is not `food`).
+    void grow() {
+        Cell tail = ring[(head + length) % CELLS];
+        occupied.set(tail);
+        zobrist ^= keys().body(0, tail);
+        ++length;
+    }
+
+private:
+    static const ZobristKeys<W, H>& keys() { return zobristKeys<W, H>(); }
+};
+
+// ---------- Items ----------
+// Extra food and timed power-ups on top of the state's own food. They live in
+// a per-cell grid, so checking what the head landed on is one lookup, and
+// their lifetimes in a timer wheel, so a tick only looks at the items that
+// expire on it rather than at every item on the board.
+enum class ItemKind : uint8_t { NONE, FOOD, BONUS, SLOW };
+constexpr int ITEM_KINDS = 4;
+
+// Single-level wheel of SLOTS buckets, one per tick mod SLOTS. An entry due
+// more than SLOTS ticks ahead simply stays in its bucket for extra rounds.
+template <typename T>
+class TimerWheel {
+public:
+    static constexpr uint32_t SLOTS = 256;
+
+    void schedule(uint32_t due, T value) { slots[due % SLOTS].push_back({due, value}); }
+
+    // Calls f(value) for every entry due at `now`; call once per tick.
+    template <typename F>
+    void advance(uint32_t now, F&& f) {
+        auto& bucket = slots[now % SLOTS];
+        for (size_t i = 0; i < bucket.size();) {
+            if (bucket[i].due == now) {
+                T value = bucket[i].value;
+                bucket[i] = bucket.back();
+                bucket.pop_back();
+                f(value);
+            } else {
+                ++i;
+            }
         }
-        for (const auto &p : snake) board[p.y][p.x] = SNAKE_CHAR;
-        board[food.y][food.x] = FOOD_CHAR;
+    }
 
-        clear_screen();
+    // Distance from `now` to the first slot holding anything, at most
+    // `limit`; what it finds may be due on a later turn of the wheel.
+    uint32_t untilNext(uint32_t now, uint32_t limit) const {
+        for (uint32_t d = 0; d < limit && d < SLOTS; ++d) {
+            if (!slots[(now + d) % SLOTS].empty()) return d;
+        }
+        return limit;
+    }
 
-        // top border
-        cout << '+';
-        for (int i = 0; i < WIDTH; ++i) cout << '-';
-        cout << "+\n";
+    void clear() { for (auto& b : slots) b.clear(); }
 
-        for (int y = 0; y < HEIGHT; ++y) {
-            cout << '|';
-            for (int x = 0; x < WIDTH; ++x) cout << board[y][x];
-            cout << "|\n";
+private:
+    struct Entry {
+        uint32_t due;
+        T value;
+    };
+    std::array<std::vector<Entry>, SLOTS> slots;
+};
+
+template <int W, int H>
+class ItemGrid {
+public:
+    using Cell = CellIndex<W, H>;
+    static constexpr uint32_t FOREVER = 0;
+
+    ItemGrid() : kind(W * H, ItemKind::NONE), expiresAt(W * H, FOREVER) {}
+
+    ItemKind at(int cell) const { return kind[cell]; }
+    uint32_t expiry(int cell) const { return expiresAt[cell]; }
+    int count(ItemKind k) const { return counts[static_cast<int>(k)]; }
+
+    // Puts an item on an empty cell; it disappears at tick `expires` unless
+    // that is FOREVER.
+    bool place(int cell, ItemKind k, uint32_t expires = FOREVER) {
+        if (kind[cell] != ItemKind::NONE || k == ItemKind::NONE) return false;
+        kind[cell] = k;
+        expiresAt[cell] = expires;
+        ++counts[static_cast<int>(k)];
+        if (expires != FOREVER) wheel.schedule(expires, Cell(cell));
+        return true;
+    }
+
+    // Removes and returns whatever is on `cell`. A pending timer for it is
+    // left in the wheel and ignored when it fires.
+    ItemKind take(int cell) {
+        ItemKind k = kind[cell];
+        if (k != ItemKind::NONE) {
+            kind[cell] = ItemKind::NONE;
+            --counts[static_cast<int>(k)];
         }
+        return k;
+    }
 
-        // bottom border
-        cout << '+';
-        for (int i = 0; i < WIDTH; ++i) cout << '-';
-        cout << "+\n";
+    // Removes the items whose time is up at tick `now`; returns how many.
+    int expire(uint32_t now) {
+        int removed = 0;
+        wheel.advance(now, [&](Cell c) {
+            // Skip timers whose item was eaten (and maybe replaced) since.
+            if (kind[c] != ItemKind::NONE && expiresAt[c] == now) {
+                take(c);
+                ++removed;
+            }
+        });
+        return removed;
+    }
 
-        // Player name + score on same line
-        cout << playerName << "   Score: " << score << "   Controls: WASD or Arrow keys. Press 'q' to quit.\n";
-        cout << flush;
+    void clear() {
+        std::fill(kind.begin(), kind.end(), ItemKind::NONE);
+        counts = {};
+        wheel.clear();
     }
+
+private:
+    std::vector<ItemKind> kind;
+    std::vector<uint32_t> expiresAt;
+    std::array<int, ITEM_KINDS> counts{};
+    TimerWheel<Cell> wheel;
 };
 
-int main() {
-    SnakeGame game;
-    // show intro and allow name entry + typing animation
-    game.showIntro();
-    game.run();
-    return 0;
+// ---------- Expectimax bot ----------
+// Looks several ticks ahead on copies of the game state. At each tick the
+// snake picks the best of its three non-reversing moves; when a move eats,
+// the new food's position is a chance node averaged over a few sampled
+// placements. Every search level copies into its own preallocated state, the
+// three root moves are searched by three threads that live as long as the bot
+// (each tick only hands them their move), and iterative deepening stops at
+// the tick budget, keeping the deepest result all three finished.
+template <int W, int H, typename B = WrapAround>
+class ExpectimaxBot {
+public:
+    using State = SnakeState<W, H, B>;
+    static constexpr int MAX_DEPTH = 16;
+
+    explicit ExpectimaxBot(int foodSamples = 3) : samples(foodSamples) {
+        for (auto& w : workers) w.pool.resize(MAX_DEPTH + 1);
+        for (int i = 0; i < 3; ++i) threads[i] = std::thread([this, i] { work(i); });
+    }
+
+    ~ExpectimaxBot() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    Direction choose(const State& s, std::chrono::microseconds budget) {
+        deadline = std::chrono::steady_clock::now() + budget;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            int n = 0;
+            for (int d = 0; d < 4; ++d) {
+                if (static_cast<Direction>(d) != opposite(s.dir)) moves[n++] = static_cast<Direction>(d);
+            }
+            root = &s;
+            pending = 3;
+            ++round;
+        }
+        wake.notify_all();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this] { return pending == 0; });
+        }
+
+        int depth = MAX_DEPTH;
+        nodes = 0;
+        for (auto& w : workers) {
+            depth = std::min(depth, w.completed);
+            nodes += w.nodes;
+        }
+        lastDepth = depth;
+        int best = 0;
+        if (depth == 0) return s.dir; // budget too small to finish even one ply
+        for (int i = 1; i < 3; ++i) {
+            if (workers[i].value[depth] > workers[best].value[depth]) best = i;
+        }
+        return moves[best];
+    }
+
+    int lastSearchDepth() const { return lastDepth; }
+    long long lastNodes() const { return nodes; }
+
+private:
+    static constexpr double DEAD = -1e6;
+
+    struct Worker {
+        std::vector<State> pool;               // pool[level]: the child being searched at that level
+        std::array<double, MAX_DEPTH + 1> value{};
+        int completed = 0;
+        long long nodes = 0;
+        bool timedOut = false;
+    };
+
+    int samples;
+    std::array<Worker, 3> workers;
+    std::chrono::steady_clock::time_point deadline;
+    int lastDepth = 0;
+    long long nodes = 0;
+
+    // The current round, handed over under the mutex: thread i searches
+    // moves[i] from *root, and the last one done wakes choose().
+    std::array<std::thread, 3> threads;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const State* root = nullptr;
+    Direction moves[3] = {};
+    uint64_t round = 0;
+    int pending = 0;
+    bool quit = false;
+
+    void work(int i) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return quit || round != seen; });
+            if (quit) return;
+            seen = round;
+            lock.unlock();
+            deepen(workers[i], *root, moves[i]);
+            lock.lock();
+            if (--pending == 0) finished.notify_one();
+        }
+    }
+
+    void deepen(Worker& w, const State& s, Direction move) {
+        w.completed = 0;
+        w.nodes = 0;
+        w.timedOut = false;
+        for (int depth = 1; depth <= MAX_DEPTH; ++depth) {
+            double v = moveValue(w, s, move, depth, 0);
+            if (w.timedOut) break;
+            w.value[depth] = v;
+            w.completed = depth;
+            if (v <= DEAD + MAX_DEPTH) break; // certain death: deeper search cannot change it
+        }
+    }
+
+    // Value of playing `move` from s and searching depth - 1 further ticks.
+    double moveValue(Worker& w, const State& s, Direction move, int depth, int level) {
+        State& c = w.pool[level];
+        c = s;
+        c.dir = move;
+        StepResult r = c.step();
+        if (r == StepResult::DIED) return DEAD + level;
+        if (r == StepResult::MOVED) return search(w, c, depth - 1, level + 1);
+        double sum = 0;
+        for (int k = 0; k < samples; ++k) {
+            sum += search(w, c, depth - 1, level + 1);
+            c.placeFood(); // next sample: another food position
+        }
+        return sum / samples;
+    }
+
+    double search(Worker& w, const State& s, int depth, int level) {
+        if ((++w.nodes & 255) == 0 && std::chrono::steady_clock::now() > deadline) w.timedOut = true;
+        if (w.timedOut) return 0;
+        if (depth == 0) return evaluate(s);
+        double best = DEAD;
+        for (int d = 0; d < 4; ++d) {
+            if (static_cast<Direction>(d) == opposite(s.dir)) continue;
+            best = std::max(best, moveValue(w, s, static_cast<Direction>(d), depth, level));
+        }
+        return best;
+    }
+
+    // Score first, then closeness to the food; a penalty when the head has
+    // less room left than the body is long (likely trapped).
+    static double evaluate(const State& s) {
+        int hx = s.headCell() % W, hy = s.headCell() / W, fx = s.food % W, fy = s.food / W;
+        int dx = std::abs(hx - fx), dy = std::abs(hy - fy);
+        if constexpr (B::TORUS) {
+            dx = std::min(dx, W - dx);
+            dy = std::min(dy, H - dy);
+        }
+        double v = s.score * 10.0 - dx - dy;
+        if (reachableArea<W, H, B>(s.occupied, s.headCell()) < s.length) v -= 500;
+        return v;
+    }
+};
+
+// ---------- Observations ----------
+constexpr Direction turnLeft(Direction d) {
+    switch (d) {
+        case Direction::UP: return Direction::LEFT;
+        case Direction::LEFT: return Direction::DOWN;
+        case Direction::DOWN: return Direction::RIGHT;
+        default: return Direction::UP;
+    }
+}
+constexpr Direction turnRight(Direction d) { return opposite(turnLeft(d)); }
+
+// What a controller sees each tick, packed into 11 bits:
+//   bits 0-2   danger straight ahead / to the left / to the right
+//   bits 3-6   food is up / down / left / right (shorter way round on a torus)
+//   bits 7-10  current direction, one-hot in Direction order
+constexpr int OBSERVATION_BITS = 11;
+
+template <int W, int H, typename B>
+uint16_t observe(const SnakeState<W, H, B>& s) {
+    const auto& table = neighborTable<W, H, B>();
+    int head = s.headCell();
+    auto blocked = [&](Direction d) { return s.occupied.test(table.next[static_cast<int>(d)][head]); };
+    uint16_t obs = 0;
+    obs |= blocked(s.dir) << 0;
+    obs |= blocked(turnLeft(s.dir)) << 1;
+    obs |= blocked(turnRight(s.dir)) << 2;
+    int dx = s.food % W - head % W, dy = s.food / W - head / W;
+    if constexpr (B::TORUS) {
+        if (dx > W / 2) dx -= W;
+        if (dx < -W / 2) dx += W;
+        if (dy > H / 2) dy -= H;
+        if (dy < -H / 2) dy += H;
+    }
+    obs |= (dy < 0) << 3;
+    obs |= (dy > 0) << 4;
+    obs |= (dx < 0) << 5;
+    obs |= (dx > 0) << 6;
+    obs |= 1 << (7 + static_cast<int>(s.dir));
+    return obs;
+}
+
+// Controller outputs: keep going, turn left, turn right.
+constexpr Direction applyAction(Direction d, int action) {
+    return action == 1 ? turnLeft(d) : action == 2 ? turnRight(d) : d;
+}
+
+// ---------- Neural controller ----------
+// A tiny MLP (11 -> 16 ReLU -> 3) whose weights are the genome.
+struct NeuralNet {
+    static constexpr int INPUTS = OBSERVATION_BITS, HIDDEN = 16, OUTPUTS = 3;
+    static constexpr int PARAMS = HIDDEN * INPUTS + HIDDEN + OUTPUTS * HIDDEN + OUTPUTS;
+    std::array<float, PARAMS> w{};
+
+    const float* w1() const { return w.data(); }                        // [HIDDEN][INPUTS]
+    const float* b1() const { return w.data() + HIDDEN * INPUTS; }
+    const float* w2() const { return b1() + HIDDEN; }                   // [OUTPUTS][HIDDEN]
+    const float* b2() const { return w2() + OUTPUTS * HIDDEN; }
+
+    // Runs B packed observations through the net at once. The inner loops go
+    // across the batch, so the compiler turns them into SIMD multiply-adds.
+    template <int B>
+    void forward(const uint16_t* obs, int* action) const {
+        float x[INPUTS][B], h[HIDDEN][B], o[OUTPUTS][B];
+        for (int i = 0; i < INPUTS; ++i)
+            for (int b = 0; b < B; ++b) x[i][b] = (float)((obs[b] >> i) & 1);
+        for (int j = 0; j < HIDDEN; ++j) {
+            for (int b = 0; b < B; ++b) h[j][b] = b1()[j];
+            for (int i = 0; i < INPUTS; ++i) {
+                float wji = w1()[j * INPUTS + i];
+                for (int b = 0; b < B; ++b) h[j][b] += wji * x[i][b];
+            }
+            for (int b = 0; b < B; ++b) h[j][b] = std::max(h[j][b], 0.0f);
+        }
+        for (int k = 0; k < OUTPUTS; ++k) {
+            for (int b = 0; b < B; ++b) o[k][b] = b2()[k];
+            for (int j = 0; j < HIDDEN; ++j) {
+                float wkj = w2()[k * HIDDEN + j];
+                for (int b = 0; b < B; ++b) o[k][b] += wkj * h[j][b];
+            }
+        }
+        for (int b = 0; b < B; ++b) {
+            int best = 0;
+            for (int k = 1; k < OUTPUTS; ++k) if (o[k][b] > o[best][b]) best = k;
+            action[b] = best;
+        }
+    }
+};
+
+// Genome checkpoint: "SNKNN01\n", then uint32 inputs/hidden/outputs, float
+// fitness, and the weights (native byte order). Written to a temporary file
+// and renamed over the old one, so a crash never leaves half a checkpoint.
+const char GENOME_MAGIC[8] = {'S', 'N', 'K', 'N', 'N', '0', '1', '\n'};
+
+bool saveGenome(const NeuralNet& net, float fitness, const string& path) {
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    uint32_t shape[3] = {NeuralNet::INPUTS, NeuralNet::HIDDEN, NeuralNet::OUTPUTS};
+    bool ok = fwrite(GENOME_MAGIC, 1, sizeof(GENOME_MAGIC), f) == sizeof(GENOME_MAGIC) &&
+              fwrite(shape, sizeof(shape), 1, f) == 1 && fwrite(&fitness, sizeof(fitness), 1, f) == 1 &&
+              fwrite(net.w.data(), sizeof(float), net.w.size(), f) == net.w.size();
+    ok = (fclose(f) == 0) && ok;
+    return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+bool loadGenome(NeuralNet& net, const string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[8];
+    uint32_t shape[3];
+    float fitness;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, GENOME_MAGIC, sizeof(magic)) == 0 &&
+              fread(shape, sizeof(shape), 1, f) == 1 && shape[0] == NeuralNet::INPUTS &&
+              shape[1] == NeuralNet::HIDDEN && shape[2] == NeuralNet::OUTPUTS &&
+              fread(&fitness, sizeof(fitness), 1, f) == 1 &&
+              fread(net.w.data(), sizeof(float), net.w.size(), f) == net.w.size();
+    fclose(f);
+    return ok;
+}
+
+// ---------- Neuroevolution trainer ----------
+// Evolves NeuralNet controllers on the headless SnakeState: every genome
+// plays EPISODES games in lockstep (one batched forward pass per tick), the
+// population is spread over all cores, and the best genome of each
+// generation is checkpointed. Selection is by tournament with elitism;
+// children get uniform crossover plus Gaussian mutation.
+template <int W, int H>
+class Trainer {
+public:
+    static constexpr int EPISODES = 16;
+
+    Trainer(int populationSize, uint64_t seed) : population(populationSize), fitness(populationSize), rng(seed) {
+        std::normal_distribution<float> init(0.0f, 0.5f);
+        for (auto& g : population) for (float& v : g.w) v = init(rng);
+    }
+
+    void run(int generations, const string& checkpoint) {
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        cout << "Training " << population.size() << " genomes x " << EPISODES << " games on " << W << "x" << H
+             << " with " << threads << " threads\n";
+        for (int gen = 0; gen < generations; ++gen) {
+            auto start = std::chrono::steady_clock::now();
+            std::atomic<int> nextGenome{0};
+            std::atomic<long long> steps{0};
+            uint64_t episodeSeed = rng();
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < threads; ++t) {
+                pool.emplace_back([&] {
+                    long long mySteps = 0;
+                    for (int i; (i = nextGenome.fetch_add(1)) < (int)population.size();) {
+                        fitness[i] = evaluate(population[i], episodeSeed, mySteps);
+                    }
+                    steps += mySteps;
+                });
+            }
+            for (auto& t : pool) t.join();
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            int best = (int)(std::max_element(fitness.begin(), fitness.end()) - fitness.begin());
+            double mean = 0;
+            for (float f : fitness) mean += f;
+            mean /= fitness.size();
+            cout << "gen " << std::setw(4) << gen << "  best " << std::fixed << std::setprecision(2)
+                 << std::setw(8) << fitness[best] << "  mean " << std::setw(8) << mean << "  "
+                 << std::setprecision(1) << steps / secs / 1e6 << " M steps/s\n";
+            if (!saveGenome(population[best], fitness[best], checkpoint)) {
+                cout << "Cannot write checkpoint " << checkpoint << "\n";
+            }
+            if (gen + 1 < generations) breed();
+        }
+    }
+
+private:
+    static constexpr int MAX_TICKS = 4 * W * H;   // per game
+    static constexpr int STARVE_TICKS = W * H;    // ticks without food before a game is called off
+
+    std::vector<NeuralNet> population;
+    std::vector<float> fitness;
+    std::mt19937_64 rng;
+
+    // Average food eaten per game, plus a small reward for surviving.
+    static float evaluate(const NeuralNet& net, uint64_t seed, long long& steps) {
+        std::vector<SnakeState<W, H>> games(EPISODES);
+        int hungry[EPISODES] = {}, ticks[EPISODES] = {};
+        bool live[EPISODES];
+        for (int b = 0; b < EPISODES; ++b) {
+            games[b].reset(seed + b);
+            live[b] = true;
+        }
+        uint16_t obs[EPISODES];
+        int action[EPISODES];
+        for (int t = 0, running = EPISODES; t < MAX_TICKS && running > 0; ++t) {
+            for (int b = 0; b < EPISODES; ++b) obs[b] = live[b] ? observe(games[b]) : 0;
+            net.forward<EPISODES>(obs, action);
+            for (int b = 0; b < EPISODES; ++b) {
+                if (!live[b]) continue;
+                auto& g = games[b];
+                g.dir = applyAction(g.dir, action[b]);
+                StepResult r = g.step();
+                ++steps;
+                ++ticks[b];
+                hungry[b] = (r == StepResult::ATE) ? 0 : hungry[b] + 1;
+                if (r == StepResult::DIED || hungry[b] > STARVE_TICKS) {
+                    live[b] = false;
+                    --running;
+                }
+            }
+        }
+        float total = 0;
+        for (int b = 0; b < EPISODES; ++b) total += games[b].score / 10.0f + ticks[b] * 0.0005f;
+        return total / EPISODES;
+    }
+
+    int tournament() {
+        std::uniform_int_distribution<int> pick(0, (int)population.size() - 1);
+        int best = pick(rng);
+        for (int i = 0; i < 2; ++i) {
+            int c = pick(rng);
+            if (fitness[c] > fitness[best]) best = c;
+        }
+        return best;
+    }
+
+    void breed() {
+        std::vector<int> order(population.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return fitness[a] > fitness[b]; });
+        size_t elite = std::max<size_t>(1, population.size() / 20);
+
+        std::vector<NeuralNet> next;
+        next.reserve(population.size());
+        for (size_t i = 0; i < elite; ++i) next.push_back(population[order[i]]);
+        std::bernoulli_distribution coin(0.5), mutate(0.1);
+        std::normal_distribution<float> noise(0.0f, 0.2f);
+        while (next.size() < population.size()) {
+            const NeuralNet& a = population[tournament()];
+            const NeuralNet& b = population[tournament()];
+            NeuralNet child;
+            for (int i = 0; i < NeuralNet::PARAMS; ++i) {
+                child.w[i] = coin(rng) ? a.w[i] : b.w[i];
+                if (mutate(rng)) child.w[i] += noise(rng);
+            }
+            next.push_back(child);
+        }
+        population.swap(next);
+    }
+};
+
+// ---------- Game statistics ----------
+// Plays many headless bot games on every core and aggregates where heads
+// go, where and why games end, food eaten per game, and how many ticks
+// each food takes at each snake length (the curve food spawning and game
+// speed are tuned against). Each thread fills its own GameStats over its
+// own share of the games; they are merged once at the end, so the game
+// loop touches nothing shared.
+enum class GameEnd : uint8_t { SELF, WALL, STARVED, TIMEOUT };
+constexpr int GAME_ENDS = 4;
+const char* const GAME_END_NAMES[GAME_ENDS] = {"hit itself", "hit a wall", "starved", "timed out"};
+
+// Aligned so the per-thread copies never share a cache line.
+template <int W, int H>
+struct alignas(64) GameStats {
+    static constexpr int CELLS = W * H;
+
+    long long games = 0;
+    long long ticks = 0;
+    std::vector<uint64_t> headVisits = std::vector<uint64_t>(CELLS);
+    std::vector<uint64_t> deaths = std::vector<uint64_t>(CELLS); // cell the head was on
+    std::array<uint64_t, GAME_ENDS> ends{};
+    std::vector<uint64_t> foodEaten = std::vector<uint64_t>(CELLS + 1); // games by food eaten
+    // Ticks from a food appearing to it being eaten, by the snake's length
+    // when it appeared.
+    std::vector<uint64_t> foodTicks = std::vector<uint64_t>(CELLS + 1);
+    std::vector<uint64_t> foodsAtLength = std::vector<uint64_t>(CELLS + 1);
+    // New food's distance from the head, in steps ignoring the body.
+    std::vector<uint64_t> spawnDistance = std::vector<uint64_t>(W + H);
+
+    void merge(const GameStats& o) {
+        games += o.games;
+        ticks += o.ticks;
+        auto add = [](std::vector<uint64_t>& to, const std::vector<uint64_t>& from) {
+            for (size_t i = 0; i < to.size(); ++i) to[i] += from[i];
+        };
+        add(headVisits, o.headVisits);
+        add(deaths, o.deaths);
+        add(foodEaten, o.foodEaten);
+        add(foodTicks, o.foodTicks);
+        add(foodsAtLength, o.foodsAtLength);
+        add(spawnDistance, o.spawnDistance);
+        for (int i = 0; i < GAME_ENDS; ++i) ends[i] += o.ends[i];
+    }
+};
+
+// net == nullptr plays the greedy autopilot, otherwise the neural one.
+template <int W, int H, typename B = WrapAround>
+class GameAnalyzer {
+public:
+    explicit GameAnalyzer(const NeuralNet* net = nullptr) : net(net) {}
+
+    GameStats<W, H> run(long long games, uint64_t seed) const {
+        unsigned threads = (unsigned)std::max(1LL, std::min<long long>(std::thread::hardware_concurrency(), games));
+        std::vector<GameStats<W, H>> perThread(threads);
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                DistanceField<W, H, B> field;
+                long long first = games * t / threads, last = games * (t + 1) / threads;
+                for (long long g = first; g < last; ++g) play(seed + (uint64_t)g, perThread[t], field);
+            });
+        }
+        for (auto& th : pool) th.join();
+        for (unsigned t = 1; t < threads; ++t) perThread[0].merge(perThread[t]);
+        return std::move(perThread[0]);
+    }
+
+private:
+    static constexpr int MAX_TICKS = 4 * W * H;   // as in Trainer
+    static constexpr int STARVE_TICKS = W * H;
+
+    const NeuralNet* net;
+
+    static int distance(int a, int b) {
+        int dx = std::abs(a % W - b % W), dy = std::abs(a / W - b / W);
+        if (B::TORUS) {
+            dx = std::min(dx, W - dx);
+            dy = std::min(dy, H - dy);
+        }
+        return dx + dy;
+    }
+
+    void play(uint64_t seed, GameStats<W, H>& st, DistanceField<W, H, B>& field) const {
+        SnakeState<W, H, B> s;
+        s.reset(seed);
+        field.rebuild(s.occupied, s.food);
+        st.spawnDistance[distance(s.headCell(), s.food)]++;
+        int spawnLength = s.length, sinceFood = 0;
+        GameEnd end = GameEnd::TIMEOUT;
+        for (int t = 0; t < MAX_TICKS; ++t) {
+            if (net) {
+                uint16_t obs = observe(s);
+                int action;
+                net->forward<1>(&obs, &action);
+                s.dir = applyAction(s.dir, action);
+            } else {
+                s.dir = greedyMove(field, s.occupied, s.headCell(), s.dir);
+            }
+            int before = s.headCell();
+            typename SnakeState<W, H, B>::Cell freed;
+            StepResult r = s.step(&freed);
+            ++st.ticks;
+            if (r == StepResult::DIED) {
+                // A closed edge maps a cell to itself (see the boundary policies).
+                bool wall = neighborTable<W, H, B>().next[static_cast<int>(s.dir)][before] == before;
+                end = wall ? GameEnd::WALL : GameEnd::SELF;
+                st.deaths[before]++;
+                break;
+            }
+            st.headVisits[s.headCell()]++;
+            ++sinceFood;
+            if (r == StepResult::ATE) {
+                st.foodTicks[spawnLength] += sinceFood;
+                st.foodsAtLength[spawnLength]++;
+                st.spawnDistance[distance(s.headCell(), s.food)]++;
+                spawnLength = s.length;
+                sinceFood = 0;
+                field.rebuild(s.occupied, s.food);
+            } else {
+                field.cellBlocked(s.occupied, s.headCell());
+                field.cellFreed(s.occupied, freed);
+                if (sinceFood > STARVE_TICKS) {
+                    end = GameEnd::STARVED;
+                    st.deaths[s.headCell()]++;
+                    break;
+                }
+            }
+        }
+        st.ends[static_cast<int>(end)]++;
+        st.foodEaten[std::min(s.score / 10, W * H)]++;
+        st.games++;
+    }
+};
+
+// Writes counts as a binary greyscale PGM, `scale` pixels per cell, on a
+// log scale so rare cells still show next to the busiest ones.
+bool writeHeatmap(const string& path, int w, int h, const std::vector<uint64_t>& counts, int scale = 8) {
+    uint64_t most = *std::max_element(counts.begin(), counts.end());
+    double top = std::log1p((double)most);
+    std::vector<unsigned char> pixels((size_t)w * scale * h * scale);
+    for (int y = 0; y < h * scale; ++y) {
+        for (int x = 0; x < w * scale; ++x) {
+            uint64_t c = counts[(y / scale) * w + x / scale];
+            pixels[(size_t)y * w * scale + x] = top > 0 ? (unsigned char)(255.0 * std::log1p((double)c) / top + 0.5) : 0;
+        }
+    }
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fprintf(f, "P5\n%d %d\n255\n", w * scale, h * scale) > 0 &&
+              fwrite(pixels.data(), 1, pixels.size(), f) == pixels.size();
+    return (fclose(f) == 0) && ok;
+}
+
+template <int W, int H>
+void printGameStats(const GameStats<W, H>& st) {
+    double games = (double)std::max(1LL, st.games);
+    cout << "How games ended:";
+    for (int i = 0; i < GAME_ENDS; ++i) {
+        cout << "  " << GAME_END_NAMES[i] << " " << std::fixed << std::setprecision(1) << 100.0 * st.ends[i] / games << "%";
+    }
+    // Percentiles of food eaten per game, from the histogram.
+    auto percentile = [&](double p) {
+        uint64_t want = (uint64_t)(p * (st.games - 1)), seen = 0;
+        for (size_t i = 0; i < st.foodEaten.size(); ++i) {
+            seen += st.foodEaten[i];
+            if (seen > want) return (int)i;
+        }
+        return (int)st.foodEaten.size() - 1;
+    };
+    double eaten = 0;
+    for (size_t i = 0; i < st.foodEaten.size(); ++i) eaten += (double)i * st.foodEaten[i];
+    cout << "\nFood per game: mean " << std::setprecision(1) << eaten / games << ", p10 " << percentile(0.1)
+         << ", median " << percentile(0.5) << ", p90 " << percentile(0.9) << ", max " << percentile(1.0) << "\n";
+    cout << "Ticks to reach food, by snake length:\n";
+    const int bucket = 10;
+    for (int from = 0; from <= W * H; from += bucket) {
+        uint64_t ticks = 0, foods = 0;
+        for (int l = from; l < from + bucket && l <= W * H; ++l) {
+            ticks += st.foodTicks[l];
+            foods += st.foodsAtLength[l];
+        }
+        if (foods == 0) continue;
+        cout << "  length " << std::setw(4) << from << "-" << std::left << std::setw(4) << from + bucket - 1
+             << std::right << std::setw(8) << std::setprecision(1) << (double)ticks / foods << " ticks  ("
+             << foods << " foods)\n";
+    }
+    double spawned = 0, spawnSum = 0;
+    for (size_t d = 0; d < st.spawnDistance.size(); ++d) {
+        spawned += st.spawnDistance[d];
+        spawnSum += (double)d * st.spawnDistance[d];
+    }
+    cout << "New food appears on average " << std::setprecision(1) << spawnSum / std::max(1.0, spawned)
+         << " steps from the head\n";
+}
+
+// ---------- Dataset logging ----------
+// Records (observation, Direction, reward) for every tick of play, for
+// imitation learning. The file is columnar and fixed-width so it can be
+// memory-mapped and sliced without parsing:
+//   header  32 bytes: "SNKDS01\n", uint32 width, height, blockRows, observationBits, 8 reserved
+//   blocks  BLOCK_BYTES each: uint32 rows, uint32 reserved, then the columns
+//           uint16 observation[BLOCK_ROWS], uint8 direction[BLOCK_ROWS], int8 reward[BLOCK_ROWS]
+// Block k starts at 32 + k * BLOCK_BYTES; only the last block may hold fewer
+// than BLOCK_ROWS rows. Integers are native byte order.
+const char DATASET_MAGIC[8] = {'S', 'N', 'K', 'D', 'S', '0', '1', '\n'};
+
+struct DatasetHeader {
+    char magic[8];
+    uint32_t width, height, blockRows, observationBits;
+    uint32_t reserved[2];
+};
+
+struct DatasetBlock {
+    static constexpr int ROWS = 4096;
+    uint32_t rows;
+    uint32_t reserved;
+    uint16_t observation[ROWS];
+    uint8_t direction[ROWS];
+    int8_t reward[ROWS];
+};
+static_assert(sizeof(DatasetHeader) == 32, "dataset header layout");
+static_assert(sizeof(DatasetBlock) == 8 + DatasetBlock::ROWS * 4, "dataset block layout");
+
+// The tick loop only writes into a preallocated block; full blocks go to a
+// background thread that does the file I/O. If the writer ever falls BLOCKS
+// blocks behind, rows are dropped (and counted) rather than stalling a tick.
+class DatasetLogger {
+public:
+    // Takes ownership of out.
+    DatasetLogger(FILE* out, int width, int height) : file(out), blocks(BLOCKS) {
+        DatasetHeader h{};
+        memcpy(h.magic, DATASET_MAGIC, sizeof(h.magic));
+        h.width = width;
+        h.height = height;
+        h.blockRows = DatasetBlock::ROWS;
+        h.observationBits = OBSERVATION_BITS;
+        ioError = fwrite(&h, sizeof(h), 1, file) != 1;
+        writer = std::thread([this] { writeLoop(); });
+    }
+
+    ~DatasetLogger() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        if (fclose(file) != 0) ioError = true;
+    }
+
+    DatasetLogger(const DatasetLogger&) = delete;
+    DatasetLogger& operator=(const DatasetLogger&) = delete;
+
+    void log(uint16_t observation, Direction dir, int reward) {
+        uint64_t f = filled.load(std::memory_order_relaxed);
+        if (f - written.load(std::memory_order_acquire) >= BLOCKS) {
+            ++droppedRows;
+            return;
+        }
+        DatasetBlock& b = blocks[f % BLOCKS];
+        b.observation[row] = observation;
+        b.direction[row] = (uint8_t)dir;
+        b.reward[row] = (int8_t)reward;
+        if (++row == DatasetBlock::ROWS) {
+            b.rows = row;
+            row = 0;
+            publish(f + 1);
+        }
+    }
+
+    uint64_t dropped() const { return droppedRows; }
+    bool failed() const { return ioError; }
+
+private:
+    static constexpr uint64_t BLOCKS = 4;
+
+    FILE* file;
+    std::vector<DatasetBlock> blocks;
+    int row = 0;                         // next row in blocks[filled % BLOCKS]
+    std::atomic<uint64_t> filled{0};     // blocks handed to the writer
+    std::atomic<uint64_t> written{0};    // blocks the writer has finished with
+    uint64_t droppedRows = 0;
+    bool stopping = false;
+    std::atomic<bool> ioError{false};
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::thread writer;
+
+    // No lock on the tick side: a wake-up that races with the writer going
+    // to sleep is caught by its timed wait instead.
+    void publish(uint64_t f) {
+        filled.store(f, std::memory_order_release);
+        wake.notify_one();
+    }
+
+    void writeBlock(const DatasetBlock& b) {
+        if (fwrite(&b, sizeof(b), 1, file) != 1) ioError = true;
+    }
+
+    void writeLoop() {
+        uint64_t next = 0;
+        for (;;) {
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                wake.wait_for(lock, std::chrono::milliseconds(50),
+                              [&] { return stopping || filled.load(std::memory_order_acquire) > next; });
+                stop = stopping;
+            }
+            for (uint64_t f = filled.load(std::memory_order_acquire); next < f; ++next) {
+                writeBlock(blocks[next % BLOCKS]);
+                written.store(next + 1, std::memory_order_release);
+            }
+            if (stop) break;
+        }
+        // The producer is gone; flush its partial block.
+        if (row > 0) {
+            DatasetBlock& b = blocks[next % BLOCKS];
+            b.rows = row;
+            std::fill(b.observation + row, b.observation + DatasetBlock::ROWS, 0);
+            std::fill(b.direction + row, b.direction + DatasetBlock::ROWS, 0);
+            std::fill(b.reward + row, b.reward + DatasetBlock::ROWS, 0);
+            writeBlock(b);
+        }
+        fflush(file);
+    }
+};
+
+// Read-only view of a file: mmap on POSIX, a plain read elsewhere.
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            len = (size_t)st.st_size;
+            if (len == 0) {
+                valid = true;
+            } else {
+                void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    map = p;
+                    valid = true;
+                }
+            }
+        }
+        close(fd);
+#else
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return;
+        char chunk[65536];
+        for (size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) > 0;) buf.insert(buf.end(), chunk, chunk + n);
+        fclose(f);
+        len = buf.size();
+        valid = true;
+#endif
+    }
+    ~MappedFile() {
+#ifndef _WIN32
+        if (map) munmap(map, len);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return valid; }
+    size_t size() const { return len; }
+    const char* data() const {
+#ifndef _WIN32
+        return static_cast<const char*>(map);
+#else
+        return buf.data();
+#endif
+    }
+
+private:
+    size_t len = 0;
+    bool valid = false;
+#ifndef _WIN32
+    void* map = nullptr;
+#else
+    vector<char> buf;
+#endif
+};
+
+// Maps a dataset and prints what it holds; the loop is how a training
+// loader would walk the columns.
+int datasetStats(const string& path) {
+    MappedFile in(path);
+    const DatasetHeader* h = reinterpret_cast<const DatasetHeader*>(in.data());
+    if (!in.ok() || in.size() < sizeof(DatasetHeader) || memcmp(h->magic, DATASET_MAGIC, sizeof(h->magic)) != 0 ||
+        h->blockRows != DatasetBlock::ROWS) {
+        cout << "Not a snake dataset: " << path << "\n";
+        return 1;
+    }
+    size_t blockCount = (in.size() - sizeof(DatasetHeader)) / sizeof(DatasetBlock);
+    uint64_t rows = 0, directions[4] = {}, food = 0, deaths = 0;
+    for (size_t k = 0; k < blockCount; ++k) {
+        const DatasetBlock* b = reinterpret_cast<const DatasetBlock*>(in.data() + sizeof(DatasetHeader)) + k;
+        uint32_t n = std::min<uint32_t>(b->rows, DatasetBlock::ROWS);
+        rows += n;
+        for (uint32_t i = 0; i < n; ++i) {
+            ++directions[b->direction[i] & 3];
+            food += b->reward[i] > 0;
+            deaths += b->reward[i] < 0;
+        }
+    }
+    cout << path << ": " << h->width << "x" << h->height << " board, " << rows << " ticks in " << blockCount
+         << " blocks\n"
+         << "  up " << directions[0] << ", down " << directions[1] << ", left " << directions[2] << ", right "
+         << directions[3] << "\n"
+         << "  food eaten " << food << ", games ended " << deaths << "\n";
+    return 0;
+}
+
+// ---------- Autosave ----------
+// Lets a game in progress survive a crash or power cut. Every few ticks the
+// tick loop copies the game into a flat SavedGame (a few KB of memcpy) and
+// hands it to a background thread, which writes it to PATH.tmp, fsyncs it,
+// renames it over PATH and fsyncs the directory. PATH thus always holds one
+// whole save, the previous or the new one. A finished game erases it, so
+// only an interrupted one is resumed. Integers are native byte order.
+const char SAVE_MAGIC[8] = {'S', 'N', 'K', 'S', 'V', '0', '1', '\n'};
+
+// FNV-1a, to reject a save the disk mangled.
+inline uint64_t fnv1a(const void* p, size_t n) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < n; ++i) h = (h ^ static_cast<const unsigned char*>(p)[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+template <int W, int H, typename B>
+struct SavedGame {
+    char magic[8];
+    uint32_t width, height;
+    char boundary[8];
+    char playerName[32];
+    SnakeState<W, H, B> state;
+    uint32_t tick, slowUntil; // SnakeGame's own tick count and slow-down
+    uint64_t itemRng;
+    ItemKind itemKind[W * H];
+    uint32_t itemExpires[W * H];
+    uint64_t checksum; // of everything above
+
+    // Stamps the header and checksum; done by the writer, off the tick.
+    void seal() {
+        memcpy(magic, SAVE_MAGIC, sizeof(magic));
+        width = W;
+        height = H;
+        snprintf(boundary, sizeof(boundary), "%s", B::NAME);
+        checksum = fnv1a(this, offsetof(SavedGame, checksum));
+    }
+    // A whole save for this board and boundary.
+    bool intact() const {
+        return memcmp(magic, SAVE_MAGIC, sizeof(magic)) == 0 && width == W && height == H &&
+               strncmp(boundary, B::NAME, sizeof(boundary)) == 0 && checksum == fnv1a(this, offsetof(SavedGame, checksum));
+    }
+};
+
+// Writes data to path so that path holds either its old contents or all of
+// data afterwards, even across a power cut.
+bool writeDurably(const std::string& path, const void* data, size_t n) {
+    std::string tmp = path + ".tmp";
+#ifndef _WIN32
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    const char* p = static_cast<const char*>(data);
+    bool ok = true;
+    for (size_t left = n; ok && left > 0;) {
+        ssize_t w = ::write(fd, p, left);
+        if (w > 0) {
+            p += w;
+            left -= w;
+        } else if (w < 0 && errno != EINTR) {
+            ok = false;
+        }
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    // The rename is only durable once the directory entry is.
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int d = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (d >= 0) {
+        fsync(d);
+        ::close(d);
+    }
+    return true;
+#else
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, n, f) == n && fflush(f) == 0 && _commit(_fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || !MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+// False if there is no save at path or it is not a whole one for Save.
+template <typename Save>
+bool loadSave(const std::string& path, Save& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    bool ok = fread(&out, sizeof(out), 1, f) == 1 && fgetc(f) == EOF;
+    fclose(f);
+    return ok && out.intact();
+}
+
+// The background writer for one game. The hand-off is a lock-free triple
+// buffer: the game fills one slot and swaps it for the latest, the writer
+// swaps the latest for the one it last wrote. Neither ever waits for the
+// other, and a save the writer has not got to yet is replaced by a newer one.
+template <typename Save>
+class Autosaver {
+public:
+    explicit Autosaver(const std::string& path) : path(path), slots(3) {
+        writer = std::thread([this] { writeLoop(); });
+    }
+    ~Autosaver() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+    Autosaver(const Autosaver&) = delete;
+    Autosaver& operator=(const Autosaver&) = delete;
+
+    // Fill this, then commit() it.
+    Save& next() { return slots[filling].save; }
+    void commit() { hand(false); }
+    // The game is finished: remove the save rather than resume it.
+    void erase() { hand(true); }
+
+    long long saved() const { return writes; }
+    bool failed() const { return ioError; }
+
+private:
+    struct Slot {
+        Save save;
+        bool erase = false;
+    };
+    static constexpr int FRESH = 4; // on `latest` until the writer takes it
+
+    std::string path;
+    std::vector<Slot> slots;
+    int filling = 0;            // the game's slot
+    int writing = 1;            // the writer's slot
+    std::atomic<int> latest{2}; // the newest handed over, | FRESH
+    std::atomic<long long> writes{0};
+    std::atomic<bool> ioError{false};
+    bool stopping = false;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::thread writer;
+
+    // As in DatasetLogger, no lock on the tick side; the writer's timed
+    // wait catches a wake-up it missed.
+    void hand(bool erase) {
+        slots[filling].erase = erase;
+        filling = latest.exchange(filling | FRESH, std::memory_order_acq_rel) & 3;
+        wake.notify_one();
+    }
+
+    void writeLoop() {
+        for (;;) {
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                wake.wait_for(lock, std::chrono::milliseconds(200),
+                              [&] { return stopping || (latest.load(std::memory_order_acquire) & FRESH); });
+                stop = stopping;
+            }
+            if (latest.load(std::memory_order_acquire) & FRESH) {
+                writing = latest.exchange(writing, std::memory_order_acq_rel) & 3;
+                Slot& s = slots[writing];
+                if (s.erase) {
+                    if (remove(path.c_str()) != 0 && errno != ENOENT) ioError = true;
+                } else {
+                    s.save.seal();
+                    if (writeDurably(path, &s.save, sizeof(s.save))) ++writes;
+                    else ioError = true;
+                }
+            }
+            if (stop) break;
+        }
+    }
+};
+
+// ---------- Two-player duel ----------
+// Two snakes share one board and one food. Both move at once each tick,
+// under SnakeState's rules: a head that reaches an occupied cell dies, and
+// a tail has not moved yet when the other head arrives. Two heads that meet
+// on one cell both die. As with SnakeState, everything sits in fixed-size
+// arrays, so a snapshot is a plain copy.
+template <int W, int H, typename B = WrapAround>
+struct DuelState {
+    using Cell = CellIndex<W, H>;
+    static constexpr int CELLS = W * H;
+    static constexpr int PLAYERS = 2;
+
+    struct Snake {
+        std::array<Cell, CELLS> ring{}; // as SnakeState: head at ring[head]
+        int head = 0;
+        int length = 0;
+        Direction dir = Direction::RIGHT;
+        int score = 0;
+        bool alive = true;
+
+        Cell headCell() const { return ring[head]; }
+        Cell bodyCell(int i) const { return ring[(head + i) % CELLS]; }
+    };
+
+    std::array<Snake, PLAYERS> snakes;
+    BitGrid<W, H> occupied;
+    Cell food = 0;
+    Rng rng;
+    uint32_t tick = 0;
+    uint64_t zobrist = 0; // bodies, heads and food, as in SnakeState
+
+    // Player 0 a third of the way down heading right, player 1 two thirds
+    // down heading left, both length 3.
+    void reset(uint64_t seed) {
+        occupied.clear();
+        rng.s = seed;
+        tick = 0;
+        for (int p = 0; p < PLAYERS; ++p) {
+            Snake& s = snakes[p];
+            int y = (p + 1) * H / 3, x = p == 0 ? W / 3 : W - 1 - W / 3;
+            s.dir = p == 0 ? Direction::RIGHT : Direction::LEFT;
+            s.head = 0;
+            s.length = 3;
+            for (int i = 0; i < s.length; ++i) {
+                s.ring[i] = Cell(y * W + (p == 0 ? x - i : x + i));
+                occupied.set(s.ring[i]);
+            }
+            s.score = 0;
+            s.alive = true;
+        }
+        placeFood();
+        zobrist = positionHash();
+    }
+
+    bool over() const { return !snakes[0].alive || !snakes[1].alive; }
+
+    // One tick with each player's wanted direction (a reversal is ignored,
+    // as in the single-player game). The tick counts even once it is over.
+    void step(const std::array<Direction, PLAYERS>& wanted) {
+        ++tick;
+        if (over()) return;
+        std::array<Cell, PLAYERS> next;
+        for (int p = 0; p < PLAYERS; ++p) {
+            Snake& s = snakes[p];
+            if (wanted[p] != opposite(s.dir)) s.dir = wanted[p];
+            next[p] = neighborTable<W, H, B>().next[static_cast<int>(s.dir)][s.headCell()];
+            if (occupied.test(next[p])) s.alive = false;
+        }
+        if (next[0] == next[1]) snakes[0].alive = snakes[1].alive = false;
+        if (over()) return;
+        const auto& k = keys();
+        bool ate = false;
+        for (int p = 0; p < PLAYERS; ++p) {
+            Snake& s = snakes[p];
+            zobrist ^= k.head(p, s.headCell()) ^ k.head(p, next[p]) ^ k.body(p, next[p]);
+            s.head = (s.head == 0) ? CELLS - 1 : s.head - 1;
+            s.ring[s.head] = next[p];
+            occupied.set(next[p]);
+            if (next[p] == food) {
+                ++s.length;
+                s.score += 10;
+                ate = true;
+            } else {
+                Cell tail = s.ring[(s.head + s.length) % CELLS];
+                occupied.reset(tail);
+                zobrist ^= k.body(p, tail);
+            }
+        }
+        if (ate) placeFood();
+    }
+
+    void placeFood() {
+        while (true) {
+            Cell c = Cell(rng.below(CELLS));
+            if (!occupied.test(c)) {
+                zobrist ^= keys().food(food) ^ keys().food(c);
+                food = c;
+                return;
+            }
+        }
+    }
+
+    // Everything that decides the game from here on, so two peers that
+    // agree on it will keep agreeing: the incremental Zobrist hash of the
+    // board, the directions, then the RNG, tick, scores and who is alive
+    // mixed in (a few multiplies, no pass over the bodies).
+    uint64_t hash() const {
+        const auto& k = keys();
+        uint64_t h = zobrist;
+        for (int p = 0; p < PLAYERS; ++p) h ^= k.dir(p, snakes[p].dir);
+        auto mix = [&](uint64_t v) { h = Rng{h ^ v}.next(); };
+        mix(rng.s);
+        mix(((uint64_t)tick << 2) | ((uint64_t)snakes[0].alive << 1) | (uint64_t)snakes[1].alive);
+        mix(((uint64_t)(uint32_t)snakes[0].score << 32) | (uint32_t)snakes[1].score);
+        return h;
+    }
+
+    // The Zobrist part of hash() from scratch (bodies, heads, food).
+    uint64_t positionHash() const {
+        const auto& k = keys();
+        uint64_t h = k.food(food);
+        for (int p = 0; p < PLAYERS; ++p) {
+            const Snake& s = snakes[p];
+            h ^= k.head(p, s.headCell());
+            for (int i = 0; i < s.length; ++i) h ^= k.body(p, s.bodyCell(i));
+        }
+        return h;
+    }
+
+private:
+    static const ZobristKeys<W, H, PLAYERS>& keys() { return zobristKeys<W, H, PLAYERS>(); }
+};
+
+// What a peer sends once per tick: its input for `tick`, and the hash of
+// its state at `checkedTick`, a tick where it knows both players' inputs.
+// Peers are the same program on one machine, so the struct goes over the
+// socket as it is.
+struct DuelMessage {
+    uint32_t tick;
+    uint32_t checkedTick;
+    uint64_t checkedHash;
+    uint8_t dir;
+    uint8_t pad[7];
+};
+static_assert(sizeof(DuelMessage) == 24, "DuelMessage is sent as raw bytes");
+
+// Deterministic lockstep for one side of a duel, without waiting on the
+// network: the other player's input for a tick not heard of yet is
+// predicted to repeat their last one. When their real input turns out
+// different, the state is restored from the snapshot taken before that
+// tick and the ticks since are simulated again. A peer never runs more
+// than WINDOW ticks ahead of the last input it has from the other, which
+// bounds both the snapshots kept and the work of one rollback.
+template <int W, int H, typename B = WrapAround>
+class Lockstep {
+public:
+    using State = DuelState<W, H, B>;
+    static constexpr uint32_t WINDOW = 16;
+
+    struct Stats {
+        long long rollbacks = 0;
+        long long resimulated = 0; // ticks simulated again
+        int deepest = 0;           // longest single rollback, in ticks
+    };
+
+    Lockstep(int me, uint64_t seed) : me(me) {
+        now.reset(seed);
+        lastRemote = now.snakes[1 - me].dir;
+    }
+
+    const State& state() const { return now; }
+    const Stats& stats() const { return counters; }
+    int player() const { return me; }
+    bool desynced() const { return mismatch; }
+    // False while the other player is WINDOW ticks behind; wait for input.
+    bool canAdvance() const { return now.tick < heard + WINDOW; }
+    // True once a confirmed tick has ended the game, so both sides see the
+    // same result.
+    bool decided() const { return heard >= now.tick ? now.over() : frames[heard % WINDOW].over(); }
+
+    // Plays the next tick with the local player's direction and returns
+    // the message for the other side. Call only when canAdvance().
+    DuelMessage advance(Direction mine) {
+        settle();
+        uint32_t t = now.tick;
+        local[t % INPUTS] = mine;
+        guessed[t % INPUTS] = t < heard ? remote[t % INPUTS] : lastRemote;
+        frames[t % WINDOW] = now;
+        now.step(inputs(t));
+        DuelMessage m = {};
+        m.tick = t;
+        m.checkedTick = std::min(heard, now.tick);
+        m.checkedHash = stateAt(m.checkedTick).hash();
+        m.dir = static_cast<uint8_t>(mine);
+        return m;
+    }
+
+    // Takes the other side's message; messages must arrive in order. The
+    // rollback it may call for is done by the next settle() or advance().
+    void receive(const DuelMessage& m) {
+        if (m.tick != heard || m.dir > 3) {
+            mismatch = true; // lost or garbled stream: no way to agree again
+            return;
+        }
+        Direction d = static_cast<Direction>(m.dir);
+        remote[m.tick % INPUTS] = d;
+        lastRemote = d;
+        if (m.tick < now.tick && guessed[m.tick % INPUTS] != d) rollbackFrom = std::min(rollbackFrom, m.tick);
+        ++heard;
+        check = m;
+        checkPending = true;
+    }
+
+    // Replays from the earliest wrong guess, then compares the other side's
+    // hash with ours for the same tick.
+    void settle() {
+        if (rollbackFrom < now.tick) {
+            uint32_t end = now.tick;
+            now = frames[rollbackFrom % WINDOW];
+            for (uint32_t t = rollbackFrom; t < end; ++t) {
+                guessed[t % INPUTS] = t < heard ? remote[t % INPUTS] : lastRemote;
+                frames[t % WINDOW] = now;
+                now.step(inputs(t));
+            }
+            ++counters.rollbacks;
+            counters.resimulated += end - rollbackFrom;
+            counters.deepest = std::max(counters.deepest, (int)(end - rollbackFrom));
+        }
+        rollbackFrom = NONE;
+        if (checkPending && check.checkedTick <= now.tick && now.tick - check.checkedTick < WINDOW &&
+            check.checkedTick <= heard) {
+            if (stateAt(check.checkedTick).hash() != check.checkedHash) mismatch = true;
+        }
+        checkPending = false;
+    }
+
+private:
+    static constexpr uint32_t INPUTS = 2 * WINDOW; // the other side runs up to WINDOW ahead
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    int me;
+    State now;
+    std::array<State, WINDOW> frames;             // frames[t % WINDOW]: the state before tick t
+    std::array<Direction, INPUTS> local{}, remote{}, guessed{};
+    uint32_t heard = 0; // the other side's inputs for ticks below this are known
+    Direction lastRemote;
+    uint32_t rollbackFrom = NONE;
+    DuelMessage check = {};
+    bool checkPending = false;
+    bool mismatch = false;
+    Stats counters;
+
+    std::array<Direction, State::PLAYERS> inputs(uint32_t t) const {
+        std::array<Direction, State::PLAYERS> in;
+        in[me] = local[t % INPUTS];
+        in[1 - me] = guessed[t % INPUTS];
+        return in;
+    }
+
+    const State& stateAt(uint32_t t) const { return t == now.tick ? now : frames[t % WINDOW]; }
+};
+
+using Cell = CellIndex<WIDTH, HEIGHT>;
+
+constexpr Cell cellAt(int x, int y) { return Cell(y * WIDTH + x); }
+constexpr int cellX(Cell c) { return c % WIDTH; }
+constexpr int cellY(Cell c) { return c / WIDTH; }
+
+#ifdef _WIN32
+void enableANSI() {
+    // Enable ANSI escape codes on Windows 10+
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hOut == INVALID_HANDLE_VALUE) return;
+    DWORD dwMode = 0;
+    if (!GetConsoleMode(hOut, &dwMode)) return;
+    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    SetConsoleMode(hOut, dwMode);
+}
+#endif
+
+// ---------- Console mode ----------
+#ifndef _WIN32
+static struct termios orig_termios;
+void reset_terminal_mode() {
+    tcsetattr(0, TCSANOW, &orig_termios);
+}
+
+// What Ctrl-C and friends must undo on the way out, since neither atexit()
+// nor any destructor runs: the output's file flags from before it went
+// non-blocking and whether the alternate screen is up. The TerminalOutput
+// drawing on the console keeps it current (restoreOnSignal()).
+struct ConsoleState {
+    volatile sig_atomic_t fd = 1;
+    volatile sig_atomic_t savedFlags = -1; // -1: output left blocking
+    volatile sig_atomic_t onScreen = 0;
+};
+static ConsoleState console_state;
+
+void restore_console_and_raise(int sig) {
+    if (console_state.savedFlags >= 0) fcntl(console_state.fd, F_SETFL, (int)console_state.savedFlags);
+    if (console_state.onScreen) {
+        static const char leave[] = "\x1B[?2026l\x1B[?25h\x1B[?1049l"; // end any frame, show cursor, main screen
+        ssize_t ignored = write(console_state.fd, leave, sizeof(leave) - 1);
+        (void)ignored;
+    }
+    tcsetattr(0, TCSANOW, &orig_termios);
+    signal(sig, SIG_DFL);
+    raise(sig); // delivered once this handler returns
+}
+
+void catch_console_signals() {
+    struct sigaction sa = {};
+    sa.sa_handler = restore_console_and_raise;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGHUP, &sa, nullptr);
+}
+
+void set_conio_terminal_mode() {
+    struct termios new_termios;
+    tcgetattr(0, &orig_termios);
+    new_termios = orig_termios;
+    // disable canonical mode, and set buffer size to 1 byte
+    new_termios.c_lflag &= ~(ICANON | ECHO);
+    new_termios.c_cc[VMIN] = 0;
+    new_termios.c_cc[VTIME] = 0;
+    tcsetattr(0, TCSANOW, &new_termios);
+    atexit(reset_terminal_mode);
+    catch_console_signals();
+}
+#endif
+
+// ---------- Utility functions ----------
+void sleep_ms(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// A line centered within board width (for intro)
+string centered(const string &s, int totalWidth = WIDTH + 2) {
+    int pad = max(0, (totalWidth - (int)s.size()) / 2);
+    return string(pad, ' ') + s + '\n';
+}
+
+// ---------- Renderer ----------
+// Remembers what the terminal shows and turns each new frame (one string per
+// screen row) into either a full repaint or cursor moves plus the changed
+// cells, whichever it estimates to be fewer bytes. Changed cells on a row are
+// coalesced into one write when rewriting the unchanged cells between them is
+// cheaper than another cursor move. Output is ANSI; rows and columns start at 1.
+class ScreenRenderer {
+public:
+    enum class Strategy { ADAPTIVE, ALWAYS_FULL, ALWAYS_DIFF };
+
+    struct Stats {
+        long long frames = 0;
+        long long fullFrames = 0;
+        long long bytes = 0;
+    };
+
+    void setStrategy(Strategy s) { strategy = s; }
+    // The screen was changed behind our back: the next frame repaints fully.
+    void invalidate() { shown.clear(); }
+    const Stats& stats() const { return counters; }
+
+    // Appends to out what turns the shown screen into `next`, ending with the
+    // cursor on the line below the frame.
+    void render(const std::vector<std::string>& next, std::string& out) {
+        size_t start = out.size();
+        bool sameShape = shown.size() == next.size();
+        size_t fullCost = 0, diffCost = 0;
+        for (const auto& line : next) fullCost += line.size() + 5; // + erase-to-end and CRLF
+        runs.clear();
+        if (sameShape && strategy != Strategy::ALWAYS_FULL) {
+            for (int r = 0; r < (int)next.size() && (diffCost < fullCost || strategy == Strategy::ALWAYS_DIFF); ++r) {
+                diffCost += findRuns(r, shown[r], next[r]);
+            }
+        }
+        bool full = !sameShape || strategy == Strategy::ALWAYS_FULL ||
+                    (strategy == Strategy::ADAPTIVE && fullCost <= diffCost);
+        if (full) {
+            out += sameShape ? "\x1B[H" : "\x1B[2J\x1B[H";
+            for (const auto& line : next) {
+                out += line;
+                out += "\x1B[K\r\n";
+            }
+            shown = next;
+            ++counters.fullFrames;
+        } else {
+            for (const Run& run : runs) {
+                moveTo(out, run.row, run.col);
+                if (run.len > 0) out.append(next[run.row], run.col, run.len);
+                else out += "\x1B[K";
+            }
+            for (const Run& run : runs) {
+                std::string& line = shown[run.row];
+                if (run.len > 0) {
+                    if (line.size() < (size_t)(run.col + run.len)) line.resize(run.col + run.len, ' ');
+                    line.replace(run.col, run.len, next[run.row], run.col, run.len);
+                } else {
+                    line.resize(run.col);
+                }
+            }
+            moveTo(out, (int)next.size(), 0);
+        }
+        ++counters.frames;
+        counters.bytes += out.size() - start;
+    }
+
+private:
+    // A write of next[row][col, col + len), or with len == 0 an erase from col
+    // to the end of the row.
+    struct Run {
+        int row, col, len;
+    };
+
+    std::vector<std::string> shown;
+    std::vector<Run> runs;
+    Strategy strategy = Strategy::ADAPTIVE;
+    Stats counters;
+
+    static int digits(int v) { return v < 10 ? 1 : v < 100 ? 2 : v < 1000 ? 3 : 4; }
+    static int moveCost(int row, int col) { return 4 + digits(row + 1) + digits(col + 1); }
+
+    static void moveTo(std::string& out, int row, int col) {
+        out += "\x1B[";
+        out += std::to_string(row + 1);
+        out += ';';
+        out += std::to_string(col + 1);
+        out += 'H';
+    }
+
+    // Appends the runs that bring row `r` from `was` to `now`; returns their cost.
+    size_t findRuns(int r, const std::string& was, const std::string& now) {
+        size_t cost = 0;
+        int open = -1; // index in runs of the run still growing on this row
+        for (int c = 0; c < (int)now.size(); ++c) {
+            if (c < (int)was.size() && was[c] == now[c]) continue;
+            if (open >= 0 && c - (runs[open].col + runs[open].len) <= moveCost(r, c)) {
+                int end = runs[open].col + runs[open].len;
+                cost += c + 1 - end;
+                runs[open].len = c + 1 - runs[open].col;
+            } else {
+                runs.push_back({r, c, 1});
+                open = (int)runs.size() - 1;
+                cost += moveCost(r, c) + 1;
+            }
+        }
+        if (was.size() > now.size()) {
+            runs.push_back({r, (int)now.size(), 0});
+            cost += moveCost(r, (int)now.size()) + 3;
+        }
+        return cost;
+    }
+};
+
+// ---------- Virtual terminal ----------
+// A VT100-style screen kept in memory. It understands what the game sends
+// (text, CR/LF, cursor position and moves, erase in display and line, and
+// private modes 25, 1049 and 2026) and skips any other escape sequence.
+// Bytes may arrive in any split, as from a real write(). --bench feeds it
+// renderer output to time the parsing side and to check that every
+// rendering strategy leaves the screen the frames describe.
+class VirtualTerminal {
+public:
+    explicit VirtualTerminal(int rows = 24, int cols = 80)
+    : height(rows), width(cols), normal(rows, std::string(cols, ' ')), alternate(normal) {}
+
+    void feed(const char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) take((unsigned char)p[i]);
+        fed += n;
+    }
+    void feed(const std::string& bytes) { feed(bytes.data(), bytes.size()); }
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    const std::string& row(int r) const { return screen()[r]; }
+    int cursorRow() const { return curRow; }
+    int cursorCol() const { return curCol; }
+    bool cursorVisible() const { return cursorShown; }
+    bool onAlternateScreen() const { return onAlt; }
+    bool inSynchronizedUpdate() const { return synchronizing; }
+    long long bytesFed() const { return fed; }
+
+    // True if the top rows read `frame`, with blanks right of each line and
+    // below the last one.
+    bool shows(const std::vector<std::string>& frame) const {
+        if ((int)frame.size() > height) return false;
+        const auto& lines = screen();
+        for (int r = 0; r < height; ++r) {
+            const std::string& want = r < (int)frame.size() ? frame[r] : std::string();
+            if ((int)want.size() > width || lines[r].compare(0, want.size(), want) != 0) return false;
+            if (lines[r].find_first_not_of(' ', want.size()) != std::string::npos) return false;
+        }
+        return true;
+    }
+    bool sameScreen(const VirtualTerminal& other) const { return screen() == other.screen(); }
+
+private:
+    enum class State { TEXT, ESCAPE, CSI };
+    int height, width;
+    std::vector<std::string> normal, alternate;
+    bool onAlt = false, cursorShown = true, synchronizing = false;
+    int curRow = 0, curCol = 0;
+    int savedRow = 0, savedCol = 0; // kept while on the alternate screen
+    bool wrapPending = false;       // last column written; the next character wraps
+    State state = State::TEXT;
+    std::vector<int> params; // -1 where a parameter was left out
+    int param = -1;
+    bool privateMode = false;
+    long long fed = 0;
+
+    std::vector<std::string>& screen() { return onAlt ? alternate : normal; }
+    const std::vector<std::string>& screen() const { return onAlt ? alternate : normal; }
+
+    void take(unsigned char ch) {
+        switch (state) {
+            case State::TEXT:
+                if (ch == 0x1B) {
+                    state = State::ESCAPE;
+                } else if (ch == '\r') {
+                    curCol = 0;
+                    wrapPending = false;
+                } else if (ch == '\n') {
+                    lineFeed();
+                } else if (ch == '\b') {
+                    if (curCol > 0) --curCol;
+                    wrapPending = false;
+                } else if (ch >= 0x20 && ch != 0x7F) {
+                    if (wrapPending) {
+                        curCol = 0;
+                        lineFeed();
+                    }
+                    screen()[curRow][curCol] = (char)ch;
+                    if (curCol + 1 < width) ++curCol;
+                    else wrapPending = true;
+                }
+                return;
+            case State::ESCAPE:
+                if (ch == '[') {
+                    state = State::CSI;
+                    params.clear();
+                    param = -1;
+                    privateMode = false;
+                } else {
+                    state = State::TEXT; // two-byte escapes change nothing we model
+                }
+                return;
+            case State::CSI:
+                if (ch >= '0' && ch <= '9') {
+                    param = std::min(std::max(param, 0) * 10 + (ch - '0'), 9999);
+                } else if (ch == ';') {
+                    params.push_back(param);
+                    param = -1;
+                } else if (ch == '?') {
+                    privateMode = true;
+                } else if (ch >= 0x40 && ch <= 0x7E) {
+                    params.push_back(param);
+                    execute((char)ch);
+                    state = State::TEXT;
+                }
+                return; // intermediates such as '$' are skipped
+        }
+    }
+
+    // Parameter i, with `def` for a missing one (and for 0 where 0 means 1).
+    int arg(size_t i, int def, bool zeroIsDefault = true) const {
+        int v = i < params.size() ? params[i] : -1;
+        return (v < 0 || (v == 0 && zeroIsDefault)) ? def : v;
+    }
+
+    void execute(char final) {
+        wrapPending = false;
+        auto clampRow = [&](int r) { return std::max(0, std::min(r, height - 1)); };
+        auto clampCol = [&](int c) { return std::max(0, std::min(c, width - 1)); };
+        auto& lines = screen();
+        if (privateMode) {
+            if (final != 'h' && final != 'l') return;
+            for (size_t i = 0; i < params.size(); ++i) setMode(params[i], final == 'h');
+            return;
+        }
+        switch (final) {
+            case 'H':
+            case 'f':
+                curRow = clampRow(arg(0, 1) - 1);
+                curCol = clampCol(arg(1, 1) - 1);
+                break;
+            case 'A': curRow = clampRow(curRow - arg(0, 1)); break;
+            case 'B': curRow = clampRow(curRow + arg(0, 1)); break;
+            case 'C': curCol = clampCol(curCol + arg(0, 1)); break;
+            case 'D': curCol = clampCol(curCol - arg(0, 1)); break;
+            case 'J': {
+                int mode = arg(0, 0, false);
+                if (mode == 2 || mode == 3) {
+                    for (auto& line : lines) line.assign(width, ' ');
+                } else if (mode == 0) {
+                    lines[curRow].replace(curCol, width - curCol, width - curCol, ' ');
+                    for (int r = curRow + 1; r < height; ++r) lines[r].assign(width, ' ');
+                } else if (mode == 1) {
+                    for (int r = 0; r < curRow; ++r) lines[r].assign(width, ' ');
+                    lines[curRow].replace(0, curCol + 1, curCol + 1, ' ');
+                }
+                break;
+            }
+            case 'K': {
+                int mode = arg(0, 0, false);
+                std::string& line = lines[curRow];
+                if (mode == 0) line.replace(curCol, width - curCol, width - curCol, ' ');
+                else if (mode == 1) line.replace(0, curCol + 1, curCol + 1, ' ');
+                else if (mode == 2) line.assign(width, ' ');
+                break;
+            }
+            default:
+                break; // device queries and anything else: no effect on the screen
+        }
+    }
+
+    void setMode(int mode, bool on) {
+        if (mode == 25) {
+            cursorShown = on;
+        } else if (mode == 2026) {
+            synchronizing = on;
+        } else if (mode == 1049 && on != onAlt) {
+            if (on) {
+                savedRow = curRow;
+                savedCol = curCol;
+                for (auto& line : alternate) line.assign(width, ' ');
+            } else {
+                curRow = savedRow;
+                curCol = savedCol;
+            }
+            onAlt = on;
+        }
+    }
+
+    void lineFeed() {
+        if (curRow + 1 < height) {
+            ++curRow;
+            return;
+        }
+        auto& lines = screen();
+        lines.erase(lines.begin());
+        lines.emplace_back(width, ' ');
+    }
+};
+
+// ---------- Terminal I/O backends ----------
+// How the game loop reads keys, writes frames and waits for the next tick.
+//   CLASSIC  select + read per key check, write per frame, 5 ms sleeps
+//   POLL     one poll() per wake-up covering input and a blocked write,
+//            sleeping until the next tick
+//   URING    Linux io_uring through raw syscalls: key reads and frame writes
+//            complete on one completion queue that is read in user space,
+//            and each wake-up is a single io_uring_enter that also submits
+//            whatever was queued
+// URING falls back to POLL when the kernel refuses a ring. Every system call
+// made for the terminal is counted, for --bench and --io reports.
+enum class IoMode { CLASSIC, POLL, URING };
+
+inline const char* ioModeName(IoMode m) {
+    return m == IoMode::URING ? "io_uring" : m == IoMode::POLL ? "poll" : "classic";
+}
+
+#ifdef SNAKE_HAVE_IO_URING
+// Just enough of io_uring for one terminal: no liburing, rings mapped by hand.
+class IoUring {
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    ~IoUring() {
+        if (sqes) munmap(sqes, sqesSize);
+        if (cqPtr && cqPtr != sqPtr) munmap(cqPtr, cqSize);
+        if (sqPtr) munmap(sqPtr, sqSize);
+        if (fd >= 0) close(fd);
+    }
+
+    // False if the kernel has no io_uring, forbids it, or lacks timed waits.
+    bool init(unsigned entries) {
+        io_uring_params p{};
+        fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) return false;
+        if (!(p.features & IORING_FEAT_EXT_ARG)) return false;
+        sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sqSize = cqSize = std::max(sqSize, cqSize);
+        sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqPtr == MAP_FAILED) return (sqPtr = nullptr), false;
+        cqPtr = single ? sqPtr : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqPtr == MAP_FAILED) return (cqPtr = nullptr), false;
+        sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+        void* s = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (s == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(s);
+
+        char* sq = static_cast<char*>(sqPtr);
+        sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqEntries = p.sq_entries;
+        sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        char* cq = static_cast<char*>(cqPtr);
+        cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    // Next free submission entry, zeroed, or nullptr if the ring is full.
+    io_uring_sqe* sqe() {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) return nullptr;
+        io_uring_sqe* e = &sqes[tail & sqMask];
+        memset(e, 0, sizeof(*e));
+        sqArray[tail & sqMask] = tail & sqMask;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++queued;
+        return e;
+    }
+
+    bool completionsReady() const { return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) != *cqHead; }
+
+    // Submits what is queued and, with minComplete > 0, waits up to
+    // timeoutMs for that many completions. One system call.
+    int enter(unsigned minComplete, int timeoutMs) {
+        __kernel_timespec ts{timeoutMs / 1000, (long long)(timeoutMs % 1000) * 1000000};
+        io_uring_getevents_arg arg{};
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        unsigned flags = IORING_ENTER_EXT_ARG | (minComplete ? IORING_ENTER_GETEVENTS : 0);
+        int r = (int)syscall(__NR_io_uring_enter, fd, queued, minComplete, flags, &arg, sizeof(arg));
+        if (r >= 0) queued -= std::min<unsigned>(queued, (unsigned)r);
+        return r;
+    }
+
+    // Calls f(user_data, res) for every completion, without a system call.
+    template <typename F>
+    void reap(F&& f) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& c = cqes[head & cqMask];
+            f(c.user_data, c.res);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd = -1;
+    void* sqPtr = nullptr;
+    void* cqPtr = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+    unsigned *sqHead = nullptr, *sqTail = nullptr, *sqArray = nullptr;
+    unsigned sqMask = 0, sqEntries = 0;
+    unsigned *cqHead = nullptr, *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned queued = 0; // entries written but not yet submitted
+};
+#endif
+
+class TerminalIo {
+public:
+    explicit TerminalIo(int inFd = 0, int outFd = 1) : inFd(inFd), outFd(outFd) {}
+#ifdef SNAKE_HAVE_IO_URING
+    ~TerminalIo() {
+        if (termiosChanged) tcsetattr(inFd, TCSANOW, &savedTermios);
+    }
+#endif
+    TerminalIo(const TerminalIo&) = delete;
+    TerminalIo& operator=(const TerminalIo&) = delete;
+
+    // Returns the mode actually in use.
+    IoMode open(IoMode wanted) {
+#ifdef _WIN32
+        (void)wanted;
+        active = IoMode::CLASSIC;
+#else
+        active = wanted;
+  #ifdef SNAKE_HAVE_IO_URING
+        if (active == IoMode::URING) {
+            ring = std::make_unique<IoUring>();
+            if (ring->init(8)) {
+                // A raw-mode read with VMIN 0 returns at once when no key is
+                // waiting; the ring's read has to block until one is.
+                if (isatty(inFd) && tcgetattr(inFd, &savedTermios) == 0) {
+                    struct termios t = savedTermios;
+                    t.c_cc[VMIN] = 1;
+                    termiosChanged = tcsetattr(inFd, TCSANOW, &t) == 0;
+                }
+                armInput(IORING_OP_READ);
+            } else {
+                ring.reset();
+                active = IoMode::POLL;
+            }
+        }
+  #else
+        if (active == IoMode::URING) active = IoMode::POLL;
+  #endif
+#endif
+        return active;
+    }
+
+    IoMode mode() const { return active; }
+    // O_NONBLOCK makes io_uring fail writes with EAGAIN instead of waiting
+    // for the terminal, so only the other modes want it.
+    bool wantsNonBlockingOutput() const { return active != IoMode::URING; }
+    long long syscalls() const { return calls; }
+
+    // Next input byte, or -1; never blocks.
+    int getKey() {
+        if (active == IoMode::CLASSIC) {
+#ifdef _WIN32
+            return _kbhit() ? _getch() : -1;
+#else
+            fd_set set;
+            struct timeval tv = {0, 0};
+            FD_ZERO(&set);
+            FD_SET(inFd, &set);
+            ++calls;
+            if (select(inFd + 1, &set, nullptr, nullptr, &tv) <= 0) return -1;
+            unsigned char ch;
+            ++calls;
+            return read(inFd, &ch, 1) == 1 ? ch : -1;
+#endif
+        }
+        if (inPos == input.size()) return -1;
+        unsigned char ch = input[inPos++];
+        if (inPos == input.size()) input.clear(), inPos = 0;
+        return ch;
+    }
+
+    int inputFd() const { return inFd; }
+    // True if getKey() has a byte to hand out right now.
+    bool inputPending() {
+        if (active != IoMode::CLASSIC) return inPos < input.size();
+#ifdef _WIN32
+        return _kbhit() != 0;
+#else
+        fd_set set;
+        struct timeval tv = {0, 0};
+        FD_ZERO(&set);
+        FD_SET(inFd, &set);
+        ++calls;
+        return select(inFd + 1, &set, nullptr, nullptr, &tv) > 0;
+#endif
+    }
+    // The other side hung up (only noticed by pullInput()).
+    bool inputClosed() const { return hungUp; }
+
+#ifndef _WIN32
+    // Reads what the input has for getKey(), for a caller that polled it
+    // itself (the Scheduler); POLL mode only.
+    void pullInput() { readInput(); }
+#endif
+
+    // Bytes written, 0 if the terminal cannot take any yet (try again after
+    // wait()), -1 on an error. With io_uring the buffer must stay untouched
+    // until the write completes, which TerminalOutput guarantees.
+    long write(const char* p, size_t n) {
+#ifdef _WIN32
+        size_t w = fwrite(p, 1, n, stdout);
+        fflush(stdout);
+        return w > 0 ? (long)w : -1;
+#else
+  #ifdef SNAKE_HAVE_IO_URING
+        if (active == IoMode::URING) {
+            if (writeResult != NO_RESULT) {
+                long r = writeResult;
+                writeResult = NO_RESULT;
+                return r < 0 ? -1 : r;
+            }
+            if (!writeInFlight) {
+                io_uring_sqe* e = ring->sqe();
+                if (!e) return 0;
+                e->opcode = IORING_OP_WRITE;
+                e->fd = outFd;
+                e->addr = (uint64_t)(uintptr_t)p;
+                e->len = (unsigned)std::min<size_t>(n, 1u << 20);
+                e->off = (uint64_t)-1; // current file position, as for a stream
+                e->user_data = WRITE_TAG;
+                writeInFlight = true;
+            }
+            return 0;
+        }
+  #endif
+        while (true) {
+            ++calls;
+            ssize_t w = ::write(outFd, p, n);
+            if (w >= 0) {
+                writeBlocked = false;
+                return (long)w;
+            }
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+            writeBlocked = true;
+            return 0;
+        }
+#endif
+    }
+
+    // The game loop's sleep: returns when input arrives or ms pass. With
+    // io_uring, the queued write is submitted by the same call and its
+    // completion does not end the sleep early (the loop only acts on ticks),
+    // so a steady tick costs one system call.
+    void wait(int ms) {
+#ifdef _WIN32
+        (void)ms;
+        sleep_ms(5);
+#else
+        if (active == IoMode::CLASSIC) {
+            ++calls;
+            sleep_ms(5);
+            return;
+        }
+  #ifdef SNAKE_HAVE_IO_URING
+        if (active == IoMode::URING) {
+            ringWait(writeInFlight ? 2 : 1, ms);
+            return;
+        }
+  #endif
+        struct pollfd p[2] = {{inFd, POLLIN, 0}, {outFd, POLLOUT, 0}};
+        ++calls;
+        if (poll(p, writeBlocked ? 2 : 1, std::max(ms, 0)) > 0 && (p[0].revents & POLLIN)) readInput();
+#endif
+    }
+
+    // Returns as soon as a pending write can progress, or after ms.
+    void waitWritable(int ms) {
+#ifdef _WIN32
+        (void)ms;
+#else
+  #ifdef SNAKE_HAVE_IO_URING
+        if (active == IoMode::URING) {
+            ringWait(1, ms);
+            return;
+        }
+  #endif
+        struct pollfd p = {outFd, POLLOUT, 0};
+        ++calls;
+        poll(&p, 1, ms);
+#endif
+    }
+
+private:
+    int inFd, outFd;
+    IoMode active = IoMode::CLASSIC;
+    long long calls = 0;
+    std::string input; // bytes read but not yet handed out
+    size_t inPos = 0;
+    bool writeBlocked = false;
+    bool hungUp = false;
+#ifdef SNAKE_HAVE_IO_URING
+    static constexpr uint64_t READ_TAG = 1, READY_TAG = 2, WRITE_TAG = 3;
+    static constexpr long NO_RESULT = LONG_MIN;
+    std::unique_ptr<IoUring> ring;
+    char inBuf[64];
+    struct termios savedTermios;
+    bool termiosChanged = false;
+    bool writeInFlight = false;
+    long writeResult = NO_RESULT;
+
+    void ringWait(unsigned minComplete, int ms) {
+        if (!ring->completionsReady()) {
+            ++calls;
+            ring->enter(minComplete, std::max(ms, 0));
+        }
+        ring->reap([&](uint64_t tag, int res) {
+            if (tag == WRITE_TAG) {
+                writeInFlight = false;
+                writeResult = res;
+            } else if (tag == READ_TAG) {
+                if (res > 0) input.append(inBuf, res);
+                // EAGAIN: the input is non-blocking, so wait for readiness first.
+                if (res > 0 || res == -EINTR) armInput(IORING_OP_READ);
+                else if (res == -EAGAIN) armInput(IORING_OP_POLL_ADD);
+            } else if (tag == READY_TAG) {
+                armInput(IORING_OP_READ);
+            }
+        });
+    }
+
+    // Keeps one read (or readiness watch) on the input in the ring.
+    void armInput(uint8_t op) {
+        io_uring_sqe* e = ring->sqe();
+        if (!e) return;
+        e->opcode = op;
+        e->fd = inFd;
+        if (op == IORING_OP_READ) {
+            e->addr = (uint64_t)(uintptr_t)inBuf;
+            e->len = sizeof(inBuf);
+            e->off = (uint64_t)-1;
+            e->user_data = READ_TAG;
+        } else {
+            e->poll32_events = POLLIN;
+            e->user_data = READY_TAG;
+        }
+    }
+#endif
+
+#ifndef _WIN32
+    void readInput() {
+        char buf[64];
+        ++calls;
+        ssize_t n = read(inFd, buf, sizeof(buf));
+        if (n > 0) input.append(buf, n);
+        else if (n == 0 ? !isatty(inFd) : errno != EAGAIN && errno != EINTR) hungUp = true;
+    }
+#endif
+};
+
+// ---------- Terminal output ----------
+// Sends rendered frames without ever blocking the game. stdout is switched
+// to non-blocking mode (or written through io_uring, see TerminalIo) and
+// holds at most one frame's bytes in flight. A frame
+// submitted while the terminal is still busy with the previous one just
+// replaces the one waiting behind it; when the terminal catches up, the
+// latest waiting frame is rendered as a single diff against the last frame
+// that was fully sent. A slow terminal therefore gets fewer, larger updates
+// instead of stalling the tick loop.
+//
+// The game runs on the alternate screen with the cursor hidden, and where
+// the terminal supports synchronized output (DEC private mode 2026) every
+// frame is bracketed by begin/end-update markers so it appears in one go
+// instead of half drawn.
+class TerminalOutput {
+public:
+    struct Stats {
+        long long submitted = 0;  // frames handed in
+        long long rendered = 0;   // frames actually turned into output
+        long long wouldBlock = 0; // writes the terminal refused
+        long long bytes = 0;
+    };
+
+    explicit TerminalOutput(int fd = 1) : fd(fd), ownIo(0, fd) {}
+    ~TerminalOutput() { setNonBlocking(false); }
+    TerminalOutput(const TerminalOutput&) = delete;
+    TerminalOutput& operator=(const TerminalOutput&) = delete;
+
+#ifndef _WIN32
+    // Marks this output as the console's, so the signal handler from
+    // set_conio_terminal_mode() knows what to put back.
+    void restoreOnSignal() {
+        isConsole = true;
+        console_state.fd = fd;
+    }
+#endif
+
+    // Call before the first frame and after the last; end() waits until
+    // everything is written so plain cout output can follow.
+    void begin() {
+        cout << flush;
+        if (io->wantsNonBlockingOutput()) setNonBlocking(true);
+        markScreen(true);
+        pending = "\x1B[?1049h\x1B[?25l"; // alternate screen, hide cursor
+        pos = 0;
+        renderer.invalidate();
+        pump();
+    }
+    void end() {
+        drain();
+        pending = "\x1B[?25h\x1B[?1049l";
+        pos = 0;
+        drain();
+        markScreen(false);
+        setNonBlocking(false);
+    }
+    // end() for a terminal that may never read again: drops any frame not
+    // yet started and queues the restore sequence; keep calling pump().
+    void finish() {
+        pending.erase(0, pos);
+        pos = 0;
+        hasWaiting = false;
+        pending += "\x1B[?25h\x1B[?1049l";
+        pump();
+    }
+
+    // Asks the terminal on inFd/fd whether it knows mode 2026 and turns
+    // frame bracketing on if so. The query is followed by a Primary Device
+    // Attributes request, which every terminal answers, so a terminal that
+    // ignores the first question costs one round trip rather than the whole
+    // timeout. Call once, with the input in raw mode, before begin().
+    // Keys pressed during the exchange are discarded.
+    bool detectSynchronized(int inFd, int timeoutMs) {
+        synchronized = false;
+#ifndef _WIN32
+        if (!isatty(inFd) || !isatty(fd)) return false;
+        const char query[] = "\x1B[?2026$p\x1B[c";
+        if (::write(fd, query, sizeof(query) - 1) != (ssize_t)(sizeof(query) - 1)) return false;
+        std::string reply;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            struct pollfd p = {inFd, POLLIN, 0};
+            if (left.count() <= 0 || poll(&p, 1, (int)left.count()) <= 0) break;
+            char buf[64];
+            ssize_t n = read(inFd, buf, sizeof(buf));
+            if (n <= 0) break;
+            reply.append(buf, n);
+            // DECRPM: ESC [ ? 2026 ; Ps $ y with Ps 1 (set) or 2 (reset) when supported
+            size_t at = reply.find("\x1B[?2026;");
+            if (at != std::string::npos && reply.size() >= at + 11) {
+                char ps = reply[at + 8];
+                synchronized = (ps == '1' || ps == '2');
+            }
+            // Primary DA reply, ESC [ ? ... c, always comes last.
+            size_t da = reply.find("\x1B[?", at == std::string::npos ? 0 : at + 1);
+            if (da != std::string::npos && reply.find('c', da) != std::string::npos) break;
+        }
+#else
+        (void)inFd;
+        (void)timeoutMs;
+#endif
+        return synchronized;
+    }
+
+    // Plain text outside the frames (the intro); the next frame repaints
+    // the whole screen.
+    void print(const std::string& text) {
+        hasWaiting = false;
+        if (pos < pending.size()) {
+            printed += text; // the bytes in flight stay put, see TerminalIo::write()
+        } else {
+            pending = text;
+            pos = 0;
+        }
+        renderer.invalidate();
+        pump();
+    }
+
+    void invalidate() { renderer.invalidate(); }
+    // Writes (and waits) through `other` instead of a classic fd; call before begin().
+    void setIo(TerminalIo* other) { io = other; }
+    ScreenRenderer& screen() { return renderer; }
+    const Stats& stats() const { return counters; }
+
+    void submit(const std::vector<std::string>& frame) {
+        ++counters.submitted;
+        if (pos < pending.size()) {
+            waiting = frame; // collapses any frame already waiting
+            hasWaiting = true;
+        } else {
+            renderNow(frame);
+        }
+        pump();
+    }
+
+    // Writes what the terminal accepts right now; true once nothing is left.
+    bool pump() {
+        while (true) {
+            while (pos < pending.size()) {
+                long n = io->write(pending.data() + pos, pending.size() - pos);
+                if (n > 0) {
+                    pos += n;
+                    counters.bytes += n;
+                } else if (n == 0) {
+                    ++counters.wouldBlock;
+                    return false;
+                } else {
+                    // Terminal gone: drop output rather than spin on it.
+                    pending.clear();
+                    printed.clear();
+                    pos = 0;
+                    hasWaiting = false;
+                    return true;
+                }
+            }
+            if (!printed.empty()) {
+                pending.swap(printed);
+                printed.clear();
+                pos = 0;
+                continue;
+            }
+            if (!hasWaiting) return true;
+            hasWaiting = false;
+            renderNow(waiting);
+        }
+    }
+
+    void drain() {
+        while (!pump()) io->waitWritable(100);
+    }
+
+private:
+    int fd;
+    TerminalIo ownIo;
+    TerminalIo* io = &ownIo;
+    ScreenRenderer renderer;
+    std::string pending; // output of the frame in flight
+    size_t pos = 0;      // bytes of it already written
+    std::string printed; // print()ed while a frame was in flight
+    std::vector<std::string> waiting;
+    bool hasWaiting = false;
+    bool synchronized = false; // bracket frames with mode 2026
+    Stats counters;
+#ifndef _WIN32
+    int savedFlags = -1;
+    bool isConsole = false;
+#endif
+
+    void renderNow(const std::vector<std::string>& frame) {
+        pending.clear();
+        pos = 0;
+        if (synchronized) pending += "\x1B[?2026h";
+        renderer.render(frame, pending);
+        if (synchronized) pending += "\x1B[?2026l";
+        ++counters.rendered;
+    }
+
+#ifndef _WIN32
+    void setNonBlocking(bool on) {
+        if (on && savedFlags < 0) {
+            savedFlags = fcntl(fd, F_GETFL);
+            if (isConsole) console_state.savedFlags = savedFlags;
+            if (savedFlags >= 0) fcntl(fd, F_SETFL, savedFlags | O_NONBLOCK);
+        } else if (!on && savedFlags >= 0) {
+            fcntl(fd, F_SETFL, savedFlags);
+            savedFlags = -1;
+            if (isConsole) console_state.savedFlags = -1;
+        }
+    }
+    void markScreen(bool on) {
+        if (isConsole) console_state.onScreen = on;
+    }
+#else
+    void setNonBlocking(bool) {}
+    void markScreen(bool) {}
+#endif
+};
+
+// ---------- Coroutine scheduler ----------
+// The game's flow (intro, play, game over, kiosk sessions) is written as
+// coroutines that suspend until a timeout, a key or a ready socket, and one
+// Scheduler per thread resumes them. Timeouts sit on a timer wheel with a
+// millisecond per slot and descriptors are watched by a single poll() per
+// wake-up, so any number of games share a thread without one holding up the
+// others. A scheduler for the console alone sleeps in the console's
+// TerminalIo::wait() instead, which keeps every I/O backend (and Windows).
+
+// A coroutine that starts when spawned or awaited, and resumes whoever
+// awaited it when it finishes.
+class Task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> awaiting;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        struct Finished {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                std::coroutine_handle<> next = h.promise().awaiting;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        Finished final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Task(Task&& other) noexcept : h(std::exchange(other.h, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (h) h.destroy();
+            h = std::exchange(other.h, {});
+        }
+        return *this;
+    }
+    ~Task() {
+        if (h) h.destroy();
+    }
+
+    bool done() const { return !h || h.done(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        h.promise().awaiting = caller;
+        return h;
+    }
+    void await_resume() const noexcept {}
+
+private:
+    friend class Scheduler;
+    explicit Task(std::coroutine_handle<promise_type> h) : h(h) {}
+    std::coroutine_handle<promise_type> h;
+};
+
+class Scheduler {
+public:
+    // co_await yields true when what was waited for happened, false when
+    // ms ran out first; ms < 0 waits as long as it takes.
+    class Wait {
+    public:
+        bool await_ready() {
+            if (io && (io->inputClosed() || io->inputPending())) return happened = true;
+            return ms == 0;
+        }
+        void await_suspend(std::coroutine_handle<> h) { slot = s.park(h, io, fd, ms); }
+        bool await_resume() const { return slot < 0 ? happened : s.waiters[slot].happened; }
+
+    private:
+        friend class Scheduler;
+        Wait(Scheduler& s, TerminalIo* io, int fd, int ms) : s(s), io(io), fd(fd), ms(ms) {}
+        Scheduler& s;
+        TerminalIo* io;
+        int fd, ms;
+        int slot = -1;
+        bool happened = false;
+    };
+
+    Scheduler() : start(std::chrono::steady_clock::now()) {}
+    // Serves the console alone (keys() on it, and timeouts).
+    explicit Scheduler(TerminalIo& console) : Scheduler() { this->console = &console; }
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    Wait sleep(int ms) { return Wait(*this, nullptr, -1, ms); }
+    // Until io has input for getKey(); the scheduler does the reading. It
+    // also returns once io's other side hangs up.
+    Wait keys(TerminalIo& io, int ms = -1) { return Wait(*this, &io, io.inputFd(), ms); }
+#ifndef _WIN32
+    Wait readable(int fd, int ms = -1) { return Wait(*this, nullptr, fd, ms); }
+#endif
+
+    // Runs t up to its first suspension; the scheduler owns it from then on.
+    void spawn(Task t) {
+        tasks.push_back(std::move(t));
+        tasks.back().h.resume();
+    }
+
+    // Resumes coroutines until every spawned one has finished, ms pass
+    // (ms < 0: no limit) or *stop is set.
+    void run(int ms = -1, const std::atomic<bool>* stop = nullptr) {
+        uint32_t deadline = ms < 0 ? UINT32_MAX : now() + (uint32_t)ms;
+        while (!(stop && stop->load())) {
+            reap();
+            uint32_t t = now();
+            if (tasks.empty() || t >= deadline) break;
+            for (; wheelNow <= t; ++wheelNow) {
+                timers.advance(wheelNow, [&](Ticket tm) {
+                    if (waiters[tm.slot].generation == tm.generation) fire(tm.slot, false);
+                });
+            }
+            uint32_t wait = timers.untilNext(wheelNow, 1000) + wheelNow - t;
+            wait = std::min(wait, deadline - t);
+            ++wakes;
+            if (console) {
+                console->wait((int)wait);
+                for (size_t i = 0; i < waiters.size(); ++i) {
+                    Waiter& w = waiters[i];
+                    if (w.active && w.io == console && console->inputPending()) fire((int)i, true);
+                }
+                continue;
+            }
+#ifndef _WIN32
+            polls.clear();
+            pollSlots.clear();
+            for (size_t i = 0; i < waiters.size(); ++i) {
+                if (!waiters[i].active || waiters[i].fd < 0) continue;
+                polls.push_back({waiters[i].fd, POLLIN, 0});
+                pollSlots.push_back(Ticket{(int)i, waiters[i].generation});
+            }
+            if (poll(polls.data(), polls.size(), (int)wait) <= 0) continue;
+            for (size_t i = 0; i < polls.size(); ++i) {
+                Ticket p = pollSlots[i];
+                if (!polls[i].revents || waiters[p.slot].generation != p.generation) continue;
+                if (TerminalIo* io = waiters[p.slot].io) io->pullInput();
+                fire(p.slot, true);
+            }
+#else
+            sleep_ms((int)wait);
+#endif
+        }
+    }
+
+    // Milliseconds since the scheduler started.
+    uint32_t now() const {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    }
+    size_t running() const { return tasks.size(); }
+    long long wakeups() const { return wakes; }
+
+private:
+    struct Waiter {
+        std::coroutine_handle<> h;
+        TerminalIo* io = nullptr;
+        int fd = -1;
+        uint32_t generation = 0; // bumped when it fires, which cancels the other way out
+        bool active = false;
+        bool happened = false;
+    };
+    struct Ticket {
+        int slot;
+        uint32_t generation;
+    };
+
+    std::chrono::steady_clock::time_point start;
+    TerminalIo* console = nullptr;
+    std::vector<Task> tasks;
+    std::vector<Waiter> waiters;
+    std::vector<int> freeSlots;
+    TimerWheel<Ticket> timers;
+    uint32_t wheelNow = 0;
+    long long wakes = 0;
+#ifndef _WIN32
+    std::vector<struct pollfd> polls;
+    std::vector<Ticket> pollSlots;
+#endif
+
+    int park(std::coroutine_handle<> h, TerminalIo* io, int fd, int ms) {
+        int slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = (int)waiters.size();
+            waiters.emplace_back();
+        }
+        Waiter& w = waiters[slot];
+        w.h = h;
+        w.io = io;
+        w.fd = console ? -1 : fd;
+        w.active = true;
+        w.happened = false;
+        if (ms > 0) timers.schedule(std::max(wheelNow, now()) + (uint32_t)ms, Ticket{slot, w.generation});
+        return slot;
+    }
+
+    // The slot is only reused after the resumed coroutine has read its result.
+    void fire(int slot, bool happened) {
+        Waiter& w = waiters[slot];
+        w.active = false;
+        w.happened = happened;
+        ++w.generation;
+        std::coroutine_handle<> h = w.h;
+        h.resume();
+        freeSlots.push_back(slot);
+    }
+
+    void reap() {
+        tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [](const Task& t) { return t.done(); }), tasks.end());
+    }
+};
+
+// ---------- Game class ----------
+enum class Autopilot { OFF, GREEDY, EXPECTIMAX, NEURAL };
+
+// Boundary is one of the policies above; each kind of game is its own type.
+template <typename Boundary = WrapAround>
+class SnakeGame {
+public:
+    // A kiosk host passes the descriptors of one player's terminal.
+    explicit SnakeGame(int inFd = 0, int outFd = 1)
+    : io(inFd, outFd), terminal(outFd), gameOver(false), playerName("Player") {
+        reset();
+    }
+
+    void reset() {
+        std::random_device rd;
+        reset(((uint64_t)rd() << 32) | rd());
+    }
+    // Same seed and same keys, same game: food and items all follow from it.
+    void reset(uint64_t seed) {
+        frame.assign(HEIGHT + 3, std::string()); // borders, board rows, status line
+        terminal.invalidate();
+        // start snake in middle, length 3
+        state.reset(seed);
+        field.rebuild(state.occupied, state.food);
+        lastObservation = observe(state);
+        items.clear();
+        itemRng.s = state.rng.next();
+        tick = 0;
+        slowUntil = 0;
+        for (int i = 1; i < foodCount; ++i) placeItem(ItemKind::FOOD, ItemGrid<WIDTH, HEIGHT>::FOREVER);
+        gameOver = false;
+        quit = false;
+        restored = false;
+    }
+
+    // Puts the console in raw mode and sets up its I/O backend; returns
+    // the TerminalIo for a Scheduler to wait on.
+    TerminalIo& openConsole() {
+#ifdef _WIN32
+        enableANSI();
+#else
+        set_conio_terminal_mode();
+        terminal.restoreOnSignal();
+#endif
+        terminal.detectSynchronized(0, 200);
+        usedIo = io.open(ioMode);
+        terminal.setIo(&io);
+        return io;
+    }
+
+    // The whole game on the console: intro (or picking up a saved game),
+    // one round, the score.
+    Task session(Scheduler& s) {
+        if (restored) co_await resumeScreen(s);
+        else co_await intro(s);
+        terminal.begin();
+        co_await play(s);
+        co_await showScore(s);
+    }
+
+    // Start-screen with ASCII title, name entry and the "typing code" animation
+    Task intro(Scheduler& s) {
+        string text = "\x1B[2J\x1B[H\n";
+        text += centered("+-------------------------------------------+");
+        text += centered("|                                           |");
+        text += centered("|               S N A K E   G A M E         |");
+        text += centered("|                                           |");
+        text += centered("+-------------------------------------------+");
+        text += "\n";
+        text += centered("A pure C++ console game. Controls: WASD or Arrow keys.");
+        text += "\n";
+        text += "Enter your name (press Enter to accept): ";
+        terminal.print(text);
+        // The console is in raw mode, so echo and backspace are ours to do
+        string name;
+        bool entered = false;
+        while (!entered && !io.inputClosed()) {
+            co_await s.keys(io);
+            for (int ch; !entered && (ch = io.getKey()) != -1;) {
+                if (ch == '\r' || ch == '\n') {
+                    entered = true;
+                } else if ((ch == 127 || ch == '\b') && !name.empty()) {
+                    name.pop_back();
+                    terminal.print("\b \b");
+                } else if (isprint(ch) && name.size() < 20) {
+                    name += (char)ch;
+                    terminal.print(string(1, (char)ch));
+                }
+            }
+        }
+        if (!name.empty()) playerName = name;
+        terminal.print("\n\n" + centered("Preparing game..."));
+        co_await s.sleep(400);
+
+        // Typewriter "code writing" effect - small fake code snippet to simulate typing
+        vector<string> fakeCode = {
+            "int main() {",
+            "    // initializing game engine",
+            "    SnakeGame game;",
+            "    game.run();",
+            "    return 0;",
+            "}"
+        };
+        terminal.print("\n");
+        for (const auto &line : fakeCode) {
+            terminal.print(centered("") + "    "); // blank line spacing, then indent a bit
+            for (char c : line) {
+                terminal.print(string(1, c));
+                co_await s.sleep(25);
+            }
+            terminal.print("\n");
+            co_await s.sleep(220);
+        }
+        terminal.print("\n" + centered("Press any key to start..."));
+        co_await anyKey(s);
+    }
+
+    // In place of the intro when an autosaved game is picked up again.
+    Task resumeScreen(Scheduler& s) {
+        string text = "\x1B[2J\x1B[H\n";
+        text += centered("Resuming " + playerName + "'s game (score " + to_string(state.score) + ")");
+        text += "\n";
+        text += centered("Press any key to continue...");
+        terminal.print(text);
+        co_await anyKey(s);
+    }
+
+    Task anyKey(Scheduler& s) {
+        while (io.getKey() == -1 && !io.inputClosed()) co_await s.keys(io);
+        while (io.inputPending()) io.getKey(); // rest of an arrow key
+        terminal.print("\x1B[2J\x1B[H");
+    }
+
+    // One round, until the snake dies or the player quits: keys are handled
+    // as they arrive and the snake moves every tickMs().
+    Task play(Scheduler& s) {
+        draw();
+        uint32_t last = s.now();
+        while (!gameOver) {
+            terminal.pump();
+            int left = tickMs() - (int)(s.now() - last);
+            if (left > 0) {
+                if (co_await s.keys(io, left)) {
+                    if (telemetry && !keyWaiting) {
+                        keyRead = Clock::now();
+                        keyWaiting = true;
+                    }
+                    handleInput();
+                }
+                if (io.inputClosed()) gameOver = quit = true;
+                continue;
+            }
+            Clock::time_point begun;
+            if (telemetry) begun = Clock::now();
+            update();
+            draw();
+            if (telemetry) publishTick(begun);
+            last = s.now();
+        }
+        draw();
+        restored = false;
+        if (autosave) autosave->erase(); // over or quit: nothing to resume
+    }
+
+    // Leaves the game screen once everything is written and prints the score.
+    Task showScore(Scheduler& s) {
+        while (!terminal.pump()) co_await s.sleep(10);
+        terminal.end();
+        cout << "\nGame Over! " << playerName << "'s Score: " << state.score << "\n";
+        if (reportIo) {
+            cout << "I/O backend " << ioModeName(usedIo) << ": " << io.syscalls() << " terminal syscalls over " << steps
+                 << " ticks (" << std::fixed << std::setprecision(1) << (double)io.syscalls() / std::max(1LL, steps)
+                 << " per tick)\n";
+        }
+    }
+
+    void setPlayerName(const string &n) { if (!n.empty()) playerName = n; }
+    void setAutopilot(Autopilot mode) { autopilot = mode; }
+    void setNeuralNet(const NeuralNet& net) { neural = std::make_unique<NeuralNet>(net); }
+    void setDatasetLogger(DatasetLogger* logger) { dataset = logger; }
+    // Publishes a TelemetrySample for every tick play() runs.
+    void setTelemetry(TelemetryWriter* writer) { telemetry = writer; }
+
+    using Save = SavedGame<WIDTH, HEIGHT, Boundary>;
+    // Hands a snapshot to `saver` every AUTOSAVE_TICKS ticks of play().
+    void setAutosave(Autosaver<Save>* saver) { autosave = saver; }
+    // Continues a saved game: the next play() picks up where it stopped.
+    void restore(const Save& g) {
+        reset(0);
+        items.clear();
+        state = g.state;
+        field.rebuild(state.occupied, state.food);
+        lastObservation = observe(state);
+        tick = g.tick;
+        slowUntil = g.slowUntil;
+        itemRng.s = g.itemRng;
+        for (int c = 0; c < WIDTH * HEIGHT; ++c) items.place(c, g.itemKind[c], g.itemExpires[c]);
+        playerName = string(g.playerName, strnlen(g.playerName, sizeof(g.playerName)));
+        restored = true;
+    }
+    bool resumable() const { return restored; }
+    // Just the copy; Autosaver stamps and checks it on its own thread.
+    void snapshot(Save& g) const {
+        g.state = state;
+        g.tick = tick;
+        g.slowUntil = slowUntil;
+        g.itemRng = itemRng.s;
+        for (int c = 0; c < WIDTH * HEIGHT; ++c) {
+            g.itemKind[c] = items.at(c);
+            g.itemExpires[c] = items.expiry(c);
+        }
+        snprintf(g.playerName, sizeof(g.playerName), "%s", playerName.c_str());
+    }
+
+    void setIoMode(IoMode mode, bool report) {
+        ioMode = mode;
+        reportIo = report;
+    }
+    // Food items kept on the board (the state's own food counts as one, at
+    // most MAX_FOOD), and whether timed power-ups appear. Takes effect on the
+    // next reset().
+    void setItems(int food, bool withPowerUps) {
+        foodCount = std::max(1, std::min(food, MAX_FOOD));
+        powerUps = withPowerUps;
+    }
+    void setRenderStrategy(ScreenRenderer::Strategy s) { terminal.screen().setStrategy(s); }
+    // Replaces the controls help on the status line; empty restores it.
+    void setStatusHint(const string& hint) { statusHint = hint; }
+
+    // Driving the game on someone else's terminal (KioskHost, benchmarks):
+    // no intro and no terminal mode changes. After attach(), either
+    // co_await play() on a poll() Scheduler, or call step() every tickMs();
+    // flush() pushes out what the terminal can take.
+    void attach() {
+        io.open(IoMode::POLL);
+        terminal.setIo(&io);
+        terminal.begin();
+    }
+    TerminalIo& input() { return io; }
+    void step() {
+        handleInput();
+        if (!gameOver) update();
+        draw();
+    }
+    void redraw() {
+        terminal.invalidate();
+        draw();
+    }
+    bool flush() { return terminal.pump(); }
+    void detach() { terminal.finish(); }
+    bool over() const { return gameOver; }
+    bool quitRequested() const { return quit; }
+    int score() const { return state.score; }
+    int length() const { return state.length; }
+    int itemCount(ItemKind k) const { return items.count(k); }
+    uint64_t stateHash() const { return state.hash(); }
+    long long stepsPlayed() const { return steps; }
+    int tickMs() const { return tick < slowUntil ? SLOW_TICK_MS : TICK_MS; }
+
+private:
+    static constexpr auto BOT_BUDGET = std::chrono::milliseconds(40); // of the 120 ms tick
+    static constexpr int TICK_MS = 120, SLOW_TICK_MS = 180; // lower = faster
+    static constexpr uint32_t BONUS_LIFETIME = 60, SLOW_LIFETIME = 80, SLOW_EFFECT = 50; // ticks
+    static constexpr int MAX_POWER_UPS = 2;
+    static constexpr uint32_t AUTOSAVE_TICKS = 8; // about a second
+
+    std::vector<std::string> frame;
+    TerminalIo io;
+    IoMode ioMode = IoMode::CLASSIC;
+    IoMode usedIo = IoMode::CLASSIC;
+    bool reportIo = false;
+    TerminalOutput terminal;
+    SnakeState<WIDTH, HEIGHT, Boundary> state;
+    DistanceField<WIDTH, HEIGHT, Boundary> field; // distance to food, for the greedy autopilot
+    Autopilot autopilot = Autopilot::OFF;
+    std::unique_ptr<ExpectimaxBot<WIDTH, HEIGHT, Boundary>> expectimax;
+    std::unique_ptr<NeuralNet> neural;
+    DatasetLogger* dataset = nullptr;
+    using Clock = std::chrono::steady_clock;
+    TelemetryWriter* telemetry = nullptr;
+    Clock::time_point keyRead; // first key since the last tick
+    bool keyWaiting = false;
+    long long bytesPublished = 0;
+    Autosaver<Save>* autosave = nullptr;
+    bool restored = false; // state came from a save rather than reset()
+    uint16_t lastObservation = 0; // what the player saw when choosing this tick's direction
+    ItemGrid<WIDTH, HEIGHT> items;
+    Rng itemRng;
+    int foodCount = 1;
+    bool powerUps = false;
+    uint32_t tick = 0;
+    uint32_t slowUntil = 0; // tick at which the slow-down power-up wears off
+    long long steps = 0;    // update()s over every round
+    bool gameOver;
+    bool quit = false; // ended with 'q' rather than a crash
+    string playerName;
+    string statusHint;
+
+    void handleInput() {
+        for (int ch; (ch = io.getKey()) != -1;) {
+#ifdef _WIN32
+            // Windows: arrow keys return 0 or 224 first
+            if (ch == 0 || ch == 224) {
+                int ch2 = io.getKey();
+                if (ch2 == -1) break;
+                switch (ch2) {
+                    case 72: tryChangeDir(Direction::UP); break;    // up arrow
+                    case 80: tryChangeDir(Direction::DOWN); break;  // down arrow
+                    case 75: tryChangeDir(Direction::LEFT); break;  // left arrow
+                    case 77: tryChangeDir(Direction::RIGHT); break; // right arrow
+                }
+            } else {
+                handleCharInput(static_cast<char>(ch));
+            }
+#else
+            // POSIX: handle arrow keys via escape sequences or WASD
+            if (ch == 27) { // possible arrow key: ESC [
+                // attempt to read two more bytes
+                int c2 = io.getKey();
+                int c3 = io.getKey();
+                if (c2 == '[' && c3 != -1) {
+                    switch (c3) {
+                        case 'A': tryChangeDir(Direction::UP); break;
+                        case 'B': tryChangeDir(Direction::DOWN); break;
+                        case 'C': tryChangeDir(Direction::RIGHT); break;
+                        case 'D': tryChangeDir(Direction::LEFT); break;
+                    }
+                }
+            } else {
+                handleCharInput(static_cast<char>(ch));
+            }
+#endif
+        }
+    }
+
+    void handleCharInput(char c) {
+        c = std::tolower(c);
+        if (c == 'w') tryChangeDir(Direction::UP);
+        else if (c == 's') tryChangeDir(Direction::DOWN);
+        else if (c == 'a') tryChangeDir(Direction::LEFT);
+        else if (c == 'd') tryChangeDir(Direction::RIGHT);
+        else if (c == 'q') gameOver = quit = true;
+        else if (c == '\f') terminal.invalidate(); // Ctrl-L: repaint everything
+    }
+
+    void tryChangeDir(Direction newDir) {
+        // prevent reversing directly
+        if (newDir == opposite(state.dir)) return;
+        state.dir = newDir;
+    }
+
+    void update() {
+        if (autopilot == Autopilot::GREEDY) {
+            tryChangeDir(greedyMove(field, state.occupied, state.headCell(), state.dir));
+        } else if (autopilot == Autopilot::EXPECTIMAX) {
+            if (!expectimax) expectimax = std::make_unique<ExpectimaxBot<WIDTH, HEIGHT, Boundary>>();
+            tryChangeDir(expectimax->choose(state, BOT_BUDGET));
+        } else if (autopilot == Autopilot::NEURAL && neural) {
+            uint16_t obs = observe(state);
+            int action;
+            neural->forward<1>(&obs, &action);
+            tryChangeDir(applyAction(state.dir, action));
+        }
+
+        Cell freed;
+        Direction chosen = state.dir;
+        int scoreBefore = state.score;
+        StepResult result = state.step(&freed);
+        bool grew = false;
+        if (result != StepResult::DIED) grew = collectItem(result);
+        switch (result) {
+            case StepResult::DIED:
+                gameOver = true;
+                break;
+            case StepResult::ATE: {
+                // The state placed its new food without looking at the items;
+                // move one it landed on elsewhere, so --food N stays N.
+                uint32_t expires = items.expiry(state.food);
+                ItemKind covered = items.take(state.food);
+                if (covered != ItemKind::NONE) placeItem(covered, expires);
+                field.rebuild(state.occupied, state.food);
+                break;
+            }
+            case StepResult::MOVED:
+                field.cellBlocked(state.occupied, state.headCell());
+                if (!grew) field.cellFreed(state.occupied, freed);
+                break;
+        }
+        ++tick;
+        ++steps;
+        items.expire(tick);
+        if (powerUps && items.count(ItemKind::BONUS) + items.count(ItemKind::SLOW) < MAX_POWER_UPS &&
+            itemRng.below(40) == 0) {
+            bool bonus = itemRng.below(2) == 0;
+            placeItem(bonus ? ItemKind::BONUS : ItemKind::SLOW, tick + (bonus ? BONUS_LIFETIME : SLOW_LIFETIME));
+        }
+        if (dataset) {
+            int reward = result == StepResult::DIED ? -1 : (state.score - scoreBefore) / 10;
+            dataset->log(lastObservation, chosen, reward);
+            lastObservation = observe(state);
+        }
+        if (autosave && !gameOver && tick % AUTOSAVE_TICKS == 0) {
+            snapshot(autosave->next());
+            autosave->commit();
+        }
+    }
+
+    void publishTick(Clock::time_point begun) {
+        auto micros = [](Clock::duration d) {
+            return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        };
+        Clock::time_point done = Clock::now();
+        long long bytes = terminal.stats().bytes;
+        TelemetrySample t;
+        t.tick = tick;
+        t.tickUs = micros(done - begun);
+        t.frameBytes = (uint32_t)(bytes - bytesPublished);
+        t.inputLatencyUs = keyWaiting ? micros(done - keyRead) : 0;
+        t.score = state.score;
+        t.length = (uint32_t)state.length;
+        telemetry->publish(t);
+        bytesPublished = bytes;
+        keyWaiting = false;
+    }
+
+    // Applies whatever item the head just landed on; true if the snake grew
+    // from it (only possible on a MOVED step).
+    bool collectItem(StepResult result) {
+        switch (items.take(state.headCell())) {
+            case ItemKind::FOOD:
+                state.score += 10;
+                placeItem(ItemKind::FOOD, ItemGrid<WIDTH, HEIGHT>::FOREVER);
+                if (result != StepResult::MOVED) return false;
+                state.grow();
+                return true;
+            case ItemKind::BONUS:
+                state.score += 50;
+                return false;
+            case ItemKind::SLOW:
+                slowUntil = tick + SLOW_EFFECT;
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    // A random cell free of snake and items. On a crowded board random picks
+    // give way to a scan, so the item is only dropped when no cell is free.
+    void placeItem(ItemKind kind, uint32_t expires) {
+        auto freeCell = [&](int c) {
+            return !state.occupied.test(c) && c != state.food && items.at(c) == ItemKind::NONE;
+        };
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            int c = itemRng.below(WIDTH * HEIGHT);
+            if (freeCell(c)) {
+                items.place(c, kind, expires);
+                return;
+            }
+        }
+        int start = itemRng.below(WIDTH * HEIGHT);
+        for (int i = 0; i < WIDTH * HEIGHT; ++i) {
+            int c = (start + i) % (WIDTH * HEIGHT);
+            if (freeCell(c)) {
+                items.place(c, kind, expires);
+                return;
+            }
+        }
+    }
+
+    // Builds the frame (row 0 and HEIGHT + 1 are borders, then the status
+    // line) and lets the renderer send only what changed since the last one.
+    void draw() {
+        static const char ITEM_CHARS[ITEM_KINDS] = {EMPTY_CHAR, FOOD_CHAR, BONUS_CHAR, SLOW_CHAR};
+        // Borders; portal openings are left as gaps
+        auto edge = [](int along, int length, char wall) {
+            return (!Boundary::TORUS && Boundary::edgeOpen(along, length)) ? ' ' : wall;
+        };
+        std::string& top = frame[0];
+        top.assign(WIDTH + 2, '+');
+        for (int i = 0; i < WIDTH; ++i) top[i + 1] = edge(i, WIDTH, '-');
+        frame[HEIGHT + 1] = top;
+
+        for (int y = 0; y < HEIGHT; ++y) {
+            std::string& row = frame[y + 1];
+            row.resize(WIDTH + 2);
+            row[0] = row[WIDTH + 1] = edge(y, HEIGHT, '|');
+            for (int x = 0; x < WIDTH; ++x) row[x + 1] = ITEM_CHARS[static_cast<int>(items.at(y * WIDTH + x))];
+        }
+        for (int i = 0; i < state.length; ++i) {
+            Cell p = state.bodyCell(i);
+            frame[cellY(p) + 1][cellX(p) + 1] = SNAKE_CHAR;
+        }
+        frame[cellY(state.food) + 1][cellX(state.food) + 1] = FOOD_CHAR;
+
+        // Player name + score on same line
+        frame[HEIGHT + 2] = playerName + "   Score: " + to_string(state.score) + "   " +
+                            (statusHint.empty() ? "Controls: WASD or Arrow keys. Press 'q' to quit." : statusHint);
+
+        terminal.submit(frame);
+    }
+};
+
+// ---------- Kiosk host ----------
+// Serves many terminals from one process: every pseudo-terminal it opens and
+// every connection on its local socket gets its own SnakeGame, played by a
+// session coroutine on one shared Scheduler, so a single poll() loop and one
+// timer wheel move them all. A session waits on a title line until its
+// player presses a key, and offers a new game after each one.
+#ifndef _WIN32
+template <typename Boundary = WrapAround>
+class KioskHost {
+public:
+    struct Stats {
+        long long ticks = 0;   // game steps, summed over sessions
+        long long wakeups = 0; // poll() calls
+        long long opened = 0;
+        long long closed = 0;
+    };
+
+    KioskHost() {
+        signal(SIGPIPE, SIG_IGN); // a player hanging up must not end everyone's game
+    }
+    ~KioskHost() {
+        for (size_t id = 0; id < sessions.size(); ++id) {
+            if (sessions[id]) drop((int)id);
+        }
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            unlink(socketPath.c_str());
+        }
+    }
+    KioskHost(const KioskHost&) = delete;
+    KioskHost& operator=(const KioskHost&) = delete;
+
+    // These apply to sessions started afterwards.
+    void setAutopilot(Autopilot mode) { autopilot = mode; }
+    // Kiosk terminal N autosaves to prefix.N and resumes from it after a
+    // crash; socket players are not saved, as their connection is gone too.
+    void setAutosave(const std::string& prefix) { savePrefix = prefix; }
+    void setItems(int food, bool withPowerUps) {
+        foodCount = food;
+        powerUps = withPowerUps;
+    }
+    size_t active() const { return live; }
+    Stats stats() const {
+        Stats st = counters;
+        st.wakeups = scheduler.wakeups();
+        for (const auto& s : sessions) {
+            if (s) st.ticks += s->game.stepsPlayed();
+        }
+        return st;
+    }
+
+    // Accepts players on a Unix socket at `path` (connect with e.g.
+    // socat -,raw,echo=0 UNIX-CONNECT:path). False on failure.
+    bool listenOn(const std::string& path) {
+        struct sockaddr_un addr = {};
+        if (listenFd >= 0 || path.size() >= sizeof(addr.sun_path)) return false;
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        unlink(path.c_str());
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+            ::close(fd);
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        listenFd = fd;
+        socketPath = path;
+        scheduler.spawn(acceptPlayers());
+        return true;
+    }
+
+    // Opens a pseudo-terminal for a kiosk screen and returns the path of
+    // its terminal side, or "" on failure. The host keeps that side open
+    // too, so a screen can come and go without ending the session.
+    std::string openPty() {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0) return "";
+        const char* name = grantpt(master) == 0 && unlockpt(master) == 0 ? ptsname(master) : nullptr;
+        int slave = name ? ::open(name, O_RDWR | O_NOCTTY) : -1;
+        if (slave < 0) {
+            ::close(master);
+            return "";
+        }
+        std::string path = name;
+        struct termios t;
+        if (tcgetattr(slave, &t) == 0) {
+            t.c_lflag &= ~(ICANON | ECHO);
+            t.c_cc[VMIN] = 1;
+            t.c_cc[VTIME] = 0;
+            tcsetattr(slave, TCSANOW, &t);
+        }
+        ++ptys;
+        adopt(master, false, slave, savePrefix.empty() ? "" : savePrefix + "." + to_string(ptys));
+        return path;
+    }
+
+    // Starts a session on an already connected descriptor, which the host
+    // then owns. A closable session ends when its player quits; the others
+    // (pseudo-terminals) just go back to the title line. With a savePath,
+    // the session autosaves there and first resumes what it finds.
+    int adopt(int fd, bool closable, int keepFd = -1, const std::string& savePath = "") {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        size_t id = 0;
+        while (id < sessions.size() && sessions[id]) ++id;
+        if (id == sessions.size()) sessions.emplace_back();
+        auto s = std::make_unique<Session>(fd, keepFd, closable);
+        s->game.setPlayerName("Player " + to_string(id + 1));
+        s->game.setAutopilot(autopilot);
+        s->game.setItems(foodCount, powerUps);
+        if (!savePath.empty()) {
+            auto saved = std::make_unique<typename SnakeGame<Boundary>::Save>();
+            if (loadSave(savePath, *saved)) s->game.restore(*saved);
+            s->saver = std::make_unique<Autosaver<typename SnakeGame<Boundary>::Save>>(savePath);
+            s->game.setAutosave(s->saver.get());
+        }
+        sessions[id] = std::move(s);
+        ++live;
+        ++counters.opened;
+        scheduler.spawn(serve((int)id));
+        return (int)id;
+    }
+
+    // Runs the sessions for `ms` milliseconds, or until *stop is set when ms < 0.
+    void run(int ms, const std::atomic<bool>* stop = nullptr) { scheduler.run(ms, stop); }
+
+private:
+    struct Session {
+        Session(int fd, int keepFd, bool closable)
+        : fd(fd), keepFd(keepFd), closable(closable), game(fd, fd) {}
+        int fd, keepFd;
+        bool closable;
+        std::unique_ptr<Autosaver<typename SnakeGame<Boundary>::Save>> saver; // outlives game
+        SnakeGame<Boundary> game;
+    };
+    static constexpr int LEAVE_GRACE_MS = 1000; // to send the restore sequence
+    static constexpr int RETRY_MS = 50;         // to push out a screen the terminal refused
+
+    std::vector<std::unique_ptr<Session>> sessions; // indexed by id; null = free
+    size_t live = 0;
+    int listenFd = -1;
+    std::string socketPath;
+    std::string savePrefix;
+    int ptys = 0; // opened so far, numbering their saves
+    Autopilot autopilot = Autopilot::OFF;
+    int foodCount = 1;
+    bool powerUps = false;
+    Stats counters;
+    Scheduler scheduler; // last, so session coroutines go before the sessions
+
+    // One player's visit: title line, rounds, and the way out.
+    Task serve(int id) {
+        Session& s = *sessions[id];
+        SnakeGame<Boundary>& game = s.game;
+        game.setStatusHint(game.resumable() ? "Press any key to resume your game." : "Press any key to play.");
+        game.attach();
+        game.redraw();
+        std::string keys;
+        bool leaving = false;
+        while (true) {
+            co_await waitKeys(s, keys);
+            if (game.input().inputClosed()) break;
+            if (keys.find('\f') != std::string::npos) {
+                game.redraw();
+                continue;
+            }
+            if (game.over() && s.closable && keys.find_first_of("qQ") != std::string::npos) {
+                leaving = true;
+                break;
+            }
+            if (!game.resumable()) game.reset();
+            game.setStatusHint("");
+            co_await game.play(scheduler);
+            if (game.input().inputClosed()) break;
+            if (game.quitRequested() && s.closable) {
+                leaving = true;
+                break;
+            }
+            game.setStatusHint(s.closable ? "Game over! Any key plays again, 'q' leaves." : "Game over! Any key plays again.");
+            game.redraw();
+        }
+        if (leaving) {
+            game.detach();
+            uint32_t since = scheduler.now();
+            while (!game.flush() && scheduler.now() - since < (uint32_t)LEAVE_GRACE_MS) co_await scheduler.sleep(10);
+        }
+        drop(id);
+    }
+
+    // Collects the player's next keys, pushing out the screen meanwhile;
+    // returns with none if the player hangs up.
+    Task waitKeys(Session& s, std::string& keys) {
+        keys.clear();
+        TerminalIo& io = s.game.input();
+        while (!io.inputClosed()) {
+            bool sent = s.game.flush();
+            if (co_await scheduler.keys(io, sent ? -1 : RETRY_MS)) break;
+        }
+        for (int ch; (ch = io.getKey()) != -1;) keys += (char)ch;
+    }
+
+    Task acceptPlayers() {
+        while (true) {
+            co_await scheduler.readable(listenFd);
+            for (int fd; (fd = accept(listenFd, nullptr, nullptr)) >= 0;) adopt(fd, true);
+        }
+    }
+
+    void drop(int id) {
+        std::unique_ptr<Session> s = std::move(sessions[id]);
+        int fd = s->fd, keepFd = s->keepFd;
+        counters.ticks += s->game.stepsPlayed();
+        s.reset(); // the game restores the descriptor's flags first
+        ::close(fd);
+        if (keepFd >= 0) ::close(keepFd);
+        --live;
+        ++counters.closed;
+    }
+};
+#endif
+
+// ---------- Duel over a local socket ----------
+// One side of a two-player duel: this terminal's player against a peer at
+// the other end of a Unix socket, kept in step by Lockstep. The hosting
+// side picks the seed and steers 'O'; the joining side steers '@'.
+#ifndef _WIN32
+template <typename Boundary = WrapAround>
+class DuelGame {
+public:
+    static constexpr char RIVAL_CHAR = '@';
+
+    // sock is connected; player 0 hosts, player 1 joined.
+    DuelGame(int sock, int player, uint64_t seed) : sock(sock), lockstep(player, seed) {
+        frame.assign(HEIGHT + 3, std::string());
+        wanted = lockstep.state().snakes[player].dir;
+    }
+
+    void run() {
+        using clock = std::chrono::steady_clock;
+        set_conio_terminal_mode();
+        terminal.restoreOnSignal();
+        terminal.detectSynchronized(0, 200);
+        io.open(IoMode::POLL);
+        terminal.setIo(&io);
+        terminal.begin();
+        auto next = clock::now();
+        bool changed = true;
+        while (!quit && !peerGone && !lockstep.decided() && !lockstep.desynced()) {
+            readKeys();
+            long long rollbacks = lockstep.stats().rollbacks;
+            readPeer();
+            lockstep.settle();
+            changed |= lockstep.stats().rollbacks != rollbacks;
+            auto t = clock::now();
+            if (t >= next) {
+                if (lockstep.canAdvance()) {
+                    DuelMessage m = lockstep.advance(wanted);
+                    if (send(sock, &m, sizeof(m), MSG_NOSIGNAL) != (ssize_t)sizeof(m)) peerGone = true;
+                    changed = true;
+                    stalled = false;
+                    next = std::max(next + TICK, t);
+                } else {
+                    changed |= !stalled;
+                    stalled = true; // the other side is behind: wait for its input
+                }
+            }
+            if (changed) draw();
+            changed = false;
+            struct pollfd p[3] = {{0, POLLIN, 0}, {sock, POLLIN, 0}, {1, POLLOUT, 0}};
+            int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next - clock::now()).count();
+            poll(p, terminal.pump() ? 2 : 3, stalled ? TICK_MS : std::max(ms, 0));
+        }
+        draw();
+        terminal.end();
+        const auto& st = lockstep.state();
+        const auto& mine = st.snakes[lockstep.player()];
+        const auto& rival = st.snakes[1 - lockstep.player()];
+        if (lockstep.desynced()) cout << "\nOut of sync with the other player (state hashes differ).\n";
+        else if (peerGone) cout << "\nThe other player left.\n";
+        else if (lockstep.decided()) {
+            cout << "\n" << (mine.alive == rival.alive ? "Draw!" : mine.alive ? "You win!" : "You lose!") << " "
+                 << mine.score << " to " << rival.score << "\n";
+        }
+        const auto& stats = lockstep.stats();
+        cout << "Rollbacks: " << stats.rollbacks << " (" << stats.resimulated << " ticks replayed, deepest "
+             << stats.deepest << ") over " << st.tick << " ticks\n";
+    }
+
+private:
+    static constexpr int TICK_MS = 120;
+    static constexpr std::chrono::milliseconds TICK{TICK_MS};
+
+    int sock;
+    Lockstep<WIDTH, HEIGHT, Boundary> lockstep;
+    TerminalIo io;
+    TerminalOutput terminal;
+    std::vector<std::string> frame;
+    std::string keys, inbox; // bytes read but not yet used
+    Direction wanted;
+    bool quit = false, peerGone = false, stalled = false;
+
+    void readKeys() {
+        char buf[64];
+        ssize_t n = read(0, buf, sizeof(buf));
+        if (n > 0) keys.append(buf, n);
+        Direction current = lockstep.state().snakes[lockstep.player()].dir;
+        size_t i = 0;
+        for (; i < keys.size(); ++i) {
+            char c = (char)std::tolower((unsigned char)keys[i]);
+            if (c == 27) {
+                if (i + 2 >= keys.size()) break; // rest of an arrow key still to come
+                if (keys[i + 1] == '[') {
+                    char a = keys[i + 2];
+                    c = a == 'A' ? 'w' : a == 'B' ? 's' : a == 'C' ? 'd' : a == 'D' ? 'a' : 0;
+                    i += 2;
+                }
+            }
+            Direction d;
+            if (c == 'w') d = Direction::UP;
+            else if (c == 's') d = Direction::DOWN;
+            else if (c == 'a') d = Direction::LEFT;
+            else if (c == 'd') d = Direction::RIGHT;
+            else {
+                if (c == 'q') quit = true;
+                continue;
+            }
+            if (d != opposite(current)) wanted = d;
+        }
+        keys.erase(0, i);
+    }
+
+    void readPeer() {
+        char buf[4096];
+        while (true) {
+            ssize_t n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0) {
+                inbox.append(buf, n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) peerGone = true;
+            break;
+        }
+        size_t at = 0;
+        for (; inbox.size() - at >= sizeof(DuelMessage); at += sizeof(DuelMessage)) {
+            DuelMessage m;
+            memcpy(&m, inbox.data() + at, sizeof(m));
+            lockstep.receive(m);
+        }
+        inbox.erase(0, at);
+    }
+
+    // As SnakeGame::draw(), with both snakes.
+    void draw() {
+        auto edge = [](int along, int length, char wall) {
+            return (!Boundary::TORUS && Boundary::edgeOpen(along, length)) ? ' ' : wall;
+        };
+        std::string& top = frame[0];
+        top.assign(WIDTH + 2, '+');
+        for (int i = 0; i < WIDTH; ++i) top[i + 1] = edge(i, WIDTH, '-');
+        frame[HEIGHT + 1] = top;
+        for (int y = 0; y < HEIGHT; ++y) {
+            std::string& row = frame[y + 1];
+            row.assign(WIDTH + 2, EMPTY_CHAR);
+            row[0] = row[WIDTH + 1] = edge(y, HEIGHT, '|');
+        }
+        const auto& st = lockstep.state();
+        for (int p = 0; p < 2; ++p) {
+            const auto& s = st.snakes[p];
+            for (int i = 0; i < s.length; ++i) {
+                Cell c = s.bodyCell(i);
+                frame[cellY(c) + 1][cellX(c) + 1] = p == 0 ? SNAKE_CHAR : RIVAL_CHAR;
+            }
+        }
+        frame[cellY(st.food) + 1][cellX(st.food) + 1] = FOOD_CHAR;
+        int me = lockstep.player();
+        char mine = me == 0 ? SNAKE_CHAR : RIVAL_CHAR, theirs = me == 0 ? RIVAL_CHAR : SNAKE_CHAR;
+        frame[HEIGHT + 2] = std::string("You (") + mine + "): " + to_string(st.snakes[me].score) + "   Rival (" +
+                            theirs + "): " + to_string(st.snakes[1 - me].score) + "   " +
+                            (stalled ? "Waiting for the other player..." : "WASD or arrows, 'q' quits.");
+        terminal.submit(frame);
+    }
+};
+#endif
+
+// ---------- Benchmarks ----------
+// The step as update() used to compute it, kept as the reference point.
+template <int W, int H>
+Point stepBranchy(Point p, Direction dir) {
+    switch (dir) {
+        case Direction::UP: p.y -= 1; break;
+        case Direction::DOWN: p.y += 1; break;
+        case Direction::LEFT: p.x -= 1; break;
+        case Direction::RIGHT: p.x += 1; break;
+    }
+    if (p.x < 0) p.x = W - 1;
+    if (p.x >= W) p.x = 0;
+    if (p.y < 0) p.y = H - 1;
+    if (p.y >= H) p.y = 0;
+    return p;
+}
+
+template <typename F>
+double nsPerOp(long long ops, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / ops;
+}
+
+void printBench(const string& name, double ns) {
+    cout << "  " << std::left << std::setw(52) << name << std::right << std::fixed << std::setprecision(2)
+         << std::setw(10) << ns << " ns/op\n";
+}
+
+// Random directions, so the branchy version pays for mispredictions the way
+// a bot or replay would.
+template <int W, int H>
+void benchStep() {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, 3);
+    std::vector<Direction> dirs(1 << 20);
+    for (auto& d : dirs) d = static_cast<Direction>(pick(rng));
+    const int reps = 16;
+    const long long ops = (long long)dirs.size() * reps;
+    volatile long long sink = 0;
+
+    double branchy = nsPerOp(ops, [&] {
+        Point p{W / 2, H / 2};
+        long long sum = 0;
+        for (int r = 0; r < reps; ++r)
+            for (Direction d : dirs) { p = stepBranchy<W, H>(p, d); sum += p.x; }
+        sink = sink + sum;
+    });
+    const auto& table = neighborTable<W, H>();
+    double tabled = nsPerOp(ops, [&] {
+        CellIndex<W, H> c = (H / 2) * W + W / 2;
+        long long sum = 0;
+        for (int r = 0; r < reps; ++r)
+            for (Direction d : dirs) { c = table.next[static_cast<int>(d)][c]; sum += c; }
+        sink = sink + sum;
+    });
+    string size = to_string(W) + "x" + to_string(H);
+    printBench("step, switch + wrap checks " + size, branchy);
+    printBench("step, neighbour table " + size, tabled);
+}
+
+// Random walls at the given density; the centre cell is kept free as the start.
+template <int W, int H>
+void benchFloodFill(double density) {
+    auto occupied = std::make_unique<BitGrid<W, H>>();
+    std::mt19937 rng(7);
+    std::bernoulli_distribution wall(density);
+    for (int c = 0; c < W * H; ++c) if (wall(rng)) occupied->set(c);
+    int start = (H / 2) * W + W / 2;
+    occupied->reset(start);
+
+    int area = 0, areaBfs = 0;
+    const int reps = (W * H > 10000) ? 20 : 2000;
+    double fill = nsPerOp(reps, [&] { for (int i = 0; i < reps; ++i) area = reachableArea(*occupied, start); });
+    double bfs = nsPerOp(reps, [&] { for (int i = 0; i < reps; ++i) areaBfs = reachableAreaBfs(*occupied, start); });
+    string label = to_string(W) + "x" + to_string(H) + " " + to_string((int)(density * 100)) + "% walls";
+    printBench("flood fill, bit-parallel " + label, fill);
+    printBench("flood fill, BFS " + label, bfs);
+    if (area != areaBfs) cout << "  MISMATCH: " << area << " vs " << areaBfs << "\n";
+}
+
+// A long snake chasing food with the greedy bot, keeping the distance field
+// current either by incremental patches or by a full BFS every tick.
+template <int W, int H>
+void benchDistanceField(int length, int ticks) {
+    const auto& table = neighborTable<W, H>();
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> anyCell(0, W * H - 1);
+    double ns[2];
+    int eaten[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        auto occupied = std::make_unique<BitGrid<W, H>>();
+        DistanceField<W, H> field;
+        std::deque<int> body;
+        // start as a zig-zag through the top rows so the body is in the way
+        for (int i = 0; i < length; ++i) {
+            int y = i / W, x = (y % 2) ? W - 1 - i % W : i % W;
+            body.push_front(y * W + x);
+            occupied->set(y * W + x);
+        }
+        rng.seed(3);
+        auto placeFood = [&] {
+            int f;
+            do f = anyCell(rng); while (occupied->test(f));
+            return f;
+        };
+        int food = placeFood();
+        field.rebuild(*occupied, food);
+        Direction dir = Direction::DOWN;
+        eaten[mode] = 0;
+        ns[mode] = nsPerOp(ticks, [&] {
+            for (int t = 0; t < ticks; ++t) {
+                dir = greedyMove(field, *occupied, body.front(), dir);
+                int next = table.next[static_cast<int>(dir)][body.front()];
+                if (occupied->test(next)) break;
+                body.push_front(next);
+                occupied->set(next);
+                if (next == food) {
+                    ++eaten[mode];
+                    food = placeFood();
+                    field.rebuild(*occupied, food);
+                    continue;
+                }
+                int tail = body.back();
+                body.pop_back();
+                occupied->reset(tail);
+                if (mode == 0) {
+                    field.cellBlocked(*occupied, next);
+                    field.cellFreed(*occupied, tail);
+                } else {
+                    field.rebuild(*occupied, food);
+                }
+            }
+        });
+    }
+    string label = to_string(W) + "x" + to_string(H) + ", length " + to_string(length);
+    printBench("distance field tick, incremental " + label, ns[0]);
+    printBench("distance field tick, full BFS " + label, ns[1]);
+    if (eaten[0] != eaten[1]) cout << "  MISMATCH: " << eaten[0] << " vs " << eaten[1] << " food eaten\n";
+}
+
+template <int W, int H>
+void benchStateClone() {
+    auto src = std::make_unique<SnakeState<W, H>>();
+    auto dst = std::make_unique<SnakeState<W, H>>();
+    src->reset(1);
+    const int reps = (W * H > 10000) ? 2000 : 1000000;
+    volatile int sink = 0;
+    double ns = nsPerOp(reps, [&] {
+        for (int i = 0; i < reps; ++i) {
+            *dst = *src;
+            sink = sink + dst->length;
+        }
+    });
+    printBench("state copy " + to_string(W) + "x" + to_string(H) + " (" + to_string(sizeof(SnakeState<W, H>)) + " B)", ns);
+}
+
+// One expectimax decision per tick budget, on a snake that has grown a bit.
+void benchExpectimax(int budgetMs) {
+    SnakeState<WIDTH, HEIGHT> s;
+    s.reset(5);
+    DistanceField<WIDTH, HEIGHT> field;
+    field.rebuild(s.occupied, s.food);
+    while (s.length < 40 && s.alive) {
+        s.dir = greedyMove(field, s.occupied, s.headCell(), s.dir);
+        s.step();
+        field.rebuild(s.occupied, s.food);
+    }
+    ExpectimaxBot<WIDTH, HEIGHT> bot;
+    const int decisions = 5;
+    long long nodes = 0;
+    int depth = 0;
+    double ns = nsPerOp(decisions, [&] {
+        for (int i = 0; i < decisions; ++i) {
+            bot.choose(s, std::chrono::milliseconds(budgetMs));
+            nodes += bot.lastNodes();
+            depth = bot.lastSearchDepth();
+        }
+    });
+    printBench("expectimax decision, " + to_string(budgetMs) + " ms budget", ns);
+    cout << "    reached depth " << depth << ", " << nodes / decisions << " nodes per decision\n";
+}
+
+// Raw headless ticks with a random controller, the trainer's inner loop,
+// under a given boundary policy.
+template <typename B>
+void benchHeadlessStep() {
+    SnakeState<WIDTH, HEIGHT, B> s;
+    const long long ticks = 20000000;
+    long long deaths = 0;
+    Rng pick;
+    double ns = nsPerOp(ticks, [&] {
+        s.reset(9);
+        for (long long t = 0; t < ticks; ++t) {
+            s.dir = applyAction(s.dir, pick.below(3));
+            if (s.step() == StepResult::DIED) {
+                ++deaths;
+                s.reset(t);
+            }
+        }
+    });
+    printBench("headless step " + to_string(WIDTH) + "x" + to_string(HEIGHT) + ", " + B::NAME, ns);
+    cout << "    " << ticks / std::max(1LL, deaths) << " ticks per game\n";
+}
+
+// Greedy games, so bodies get long: the incremental hash against hashing
+// the whole position, and a check that the two never disagree (also for
+// duels, with random steering).
+void benchZobrist() {
+    using State = SnakeState<WIDTH, HEIGHT>;
+    State s;
+    s.reset(21);
+    DistanceField<WIDTH, HEIGHT> field;
+    field.rebuild(s.occupied, s.food);
+    std::vector<State> samples;
+    long long wrong = 0, lengths = 0;
+    const int ticks = 200000;
+    for (int t = 0; t < ticks; ++t) {
+        s.dir = greedyMove(field, s.occupied, s.headCell(), s.dir);
+        Cell freed;
+        StepResult r = s.step(&freed);
+        if (r == StepResult::DIED) s.reset(t);
+        if (r == StepResult::MOVED && t % 7 == 0) s.grow(); // as collectItem() does
+        field.rebuild(s.occupied, s.food);
+        if (s.hash() != s.rehash()) ++wrong;
+        if (t % 200 == 0) {
+            samples.push_back(s);
+            lengths += s.length;
+        }
+    }
+    volatile uint64_t sink = 0;
+    const int reps = 200;
+    double incremental = nsPerOp((long long)reps * samples.size(), [&] {
+        for (int r = 0; r < reps; ++r)
+            for (const State& x : samples) sink = sink + x.hash();
+    });
+    double full = nsPerOp((long long)reps * samples.size(), [&] {
+        for (int r = 0; r < reps; ++r)
+            for (const State& x : samples) sink = sink + x.rehash();
+    });
+    printBench("zobrist hash, incremental", incremental);
+    printBench("zobrist hash, from scratch (avg length " + to_string(lengths / (long long)samples.size()) + ")", full);
+
+    DuelState<WIDTH, HEIGHT> duel;
+    duel.reset(5);
+    Rng rng{23};
+    for (int t = 0; t < ticks; ++t) {
+        duel.step({static_cast<Direction>(rng.below(4)), static_cast<Direction>(rng.below(4))});
+        if (duel.over()) duel.reset(t);
+        if (duel.zobrist != duel.positionHash()) ++wrong;
+    }
+    cout << "    " << (wrong ? "MISMATCH: " + to_string(wrong) + " ticks" : string("incremental hash matched every tick"))
+         << "\n";
+}
+
+// Batched neural inference, one observation per game.
+void benchNeuralForward() {
+    NeuralNet net;
+    Rng init;
+    for (float& v : net.w) v = (float)init.below(1000) / 500.0f - 1.0f;
+    uint16_t obs[16];
+    int action[16];
+    for (int b = 0; b < 16; ++b) obs[b] = (uint16_t)(init.next() & 0x7FF);
+    volatile int sink = 0;
+    const int reps = 200000;
+    double nsBatch = nsPerOp((long long)reps * 16, [&] {
+        for (int r = 0; r < reps; ++r) {
+            net.forward<16>(obs, action);
+            sink = sink + action[r & 15];
+            obs[r & 15] ^= 1;
+        }
+    });
+    printBench("neural forward, batch of 16 (per observation)", nsBatch);
+}
+
+#ifndef _WIN32
+// Publishing into the telemetry ring while a monitor reads it flat out from
+// another thread: cost per tick, and whether any sample came out torn.
+void benchTelemetry() {
+    string name = "/snake_bench_" + to_string(getpid());
+    TelemetryWriter writer;
+    TelemetryReader reader;
+    if (!writer.create(name) || !reader.open(name)) return;
+    const long long samples = 10000000;
+    std::atomic<bool> done{false};
+    long long seen = 0, missed = 0, torn = 0;
+    std::thread monitor([&] {
+        uint64_t next = 0;
+        while (!done) {
+            uint64_t published = reader.published();
+            if (next < reader.oldest()) {
+                missed += (long long)(reader.oldest() - next);
+                next = reader.oldest();
+            }
+            for (; next < published; ++next) {
+                TelemetrySample t;
+                if (!reader.read(next, t)) {
+                    ++missed;
+                    continue;
+                }
+                // Every field is derived from the tick, so a mixed sample shows.
+                bool whole = t.tickUs == t.tick * 3 && t.frameBytes == ~t.tick && t.score == (int32_t)(t.tick / 7) &&
+                             t.length == (t.tick & 0xFFFF) && t.inputLatencyUs == t.tick + 1;
+                if (whole) ++seen;
+                else ++torn;
+            }
+        }
+    });
+    double ns = nsPerOp(samples, [&] {
+        for (uint32_t i = 0; i < samples; ++i) {
+            writer.publish({i, i * 3, ~i, i + 1, (int32_t)(i / 7), i & 0xFFFF});
+        }
+    });
+    done = true;
+    monitor.join();
+    printBench("telemetry publish (monitor reading)", ns);
+    cout << "    monitor read " << seen << ", skipped " << missed << " overwritten, "
+         << (torn ? to_string(torn) + " TORN" : string("none torn")) << "\n";
+}
+#endif
+
+// Per-tick cost of dataset logging, including the slowest single call (the
+// block hand-off), with the writer thread doing real file I/O.
+void benchDatasetLog() {
+    FILE* f = tmpfile();
+    if (!f) return;
+    const long long rows = 4000000;
+    long long worst = 0;
+    uint64_t dropped;
+    double ns;
+    {
+        DatasetLogger logger(f, WIDTH, HEIGHT);
+        ns = nsPerOp(rows, [&] {
+            for (long long i = 0; i < rows; ++i) {
+                auto t0 = std::chrono::steady_clock::now();
+                logger.log((uint16_t)(i & 0x7FF), (Direction)(i & 3), (int)(i % 7 == 0));
+                auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0);
+                worst = std::max<long long>(worst, t.count());
+            }
+        });
+        dropped = logger.dropped();
+    }
+    printBench("dataset log (incl. clock reads)", ns);
+    cout << "    slowest call " << worst / 1000.0 << " us (includes preemption), " << dropped << " rows dropped\n";
+}
+
+// Per-tick item upkeep with `count` items on a big board: the head's cell
+// lookup, the expirations and the replacements, via ItemGrid or by scanning
+// a flat item list the way a single `food` would have grown.
+template <int W, int H>
+void benchItems(int count) {
+    struct Item {
+        int cell;
+        ItemKind kind;
+        uint32_t expires;
+    };
+    Rng rng{11};
+    auto lifetime = [&](int i) { return (i % 10 == 0) ? 1 + (uint32_t)rng.below(500) : ItemGrid<W, H>::FOREVER; };
+    auto grid = std::make_unique<ItemGrid<W, H>>();
+    std::vector<Item> list;
+    for (int i = 0; i < count; ++i) {
+        int c = rng.below(W * H);
+        uint32_t e = lifetime(i);
+        if (grid->place(c, ItemKind::FOOD, e)) list.push_back({c, ItemKind::FOOD, e});
+    }
+    const int ticks = 1000;
+    volatile long long taken[2] = {0, 0};
+    Rng walk{12};
+    double gridNs = nsPerOp(ticks, [&] {
+        for (uint32_t t = 1; t <= ticks; ++t) {
+            int head = walk.below(W * H);
+            if (grid->take(head) != ItemKind::NONE) taken[0] = taken[0] + 1;
+            int gone = grid->expire(t);
+            for (int i = 0; i < gone; ++i) grid->place(rng.below(W * H), ItemKind::FOOD, t + 1 + rng.below(500));
+        }
+    });
+    walk.s = 12;
+    const int scanTicks = 50;
+    double scanNs = nsPerOp(scanTicks, [&] {
+        for (uint32_t t = 1; t <= scanTicks; ++t) {
+            int head = walk.below(W * H);
+            for (size_t i = 0; i < list.size();) {
+                bool gone = list[i].cell == head || (list[i].expires != ItemGrid<W, H>::FOREVER && list[i].expires == t);
+                if (!gone) { ++i; continue; }
+                taken[1] = taken[1] + (list[i].cell == head);
+                list[i] = list.back();
+                list.pop_back();
+            }
+        }
+    });
+    string label = to_string(count / 1000) + "k items " + to_string(W) + "x" + to_string(H);
+    printBench("item tick, grid + wheel, " + label, gridNs);
+    printBench("item tick, list scan, " + label, scanNs);
+}
+
+// Output bytes and time per frame for the three render strategies, on a snake
+// game (few cells change) and on a busy board that scrolls a row every frame
+// (nearly every cell changes).
+void benchRenderer() {
+    const int frames = 2000;
+    auto snakeFrames = [&] {
+        std::vector<std::vector<std::string>> out;
+        SnakeState<WIDTH, HEIGHT> s;
+        s.reset(4);
+        DistanceField<WIDTH, HEIGHT> field;
+        field.rebuild(s.occupied, s.food);
+        for (int f = 0; f < frames; ++f) {
+            std::vector<std::string> rows(HEIGHT, std::string(WIDTH, EMPTY_CHAR));
+            for (int i = 0; i < s.length; ++i) rows[s.bodyCell(i) / WIDTH][s.bodyCell(i) % WIDTH] = SNAKE_CHAR;
+            rows[s.food / WIDTH][s.food % WIDTH] = FOOD_CHAR;
+            rows.push_back("Score: " + to_string(s.score));
+            out.push_back(rows);
+            s.dir = greedyMove(field, s.occupied, s.headCell(), s.dir);
+            if (s.step() == StepResult::DIED) s.reset(f);
+            field.rebuild(s.occupied, s.food);
+        }
+        return out;
+    }();
+    auto scrollFrames = [&] {
+        std::vector<std::vector<std::string>> out;
+        Rng rng{8};
+        std::vector<std::string> rows;
+        for (int y = 0; y < HEIGHT; ++y) {
+            std::string row(WIDTH, EMPTY_CHAR);
+            for (char& c : row) c = (char)('a' + rng.below(26));
+            rows.push_back(row);
+        }
+        for (int f = 0; f < frames; ++f) {
+            std::rotate(rows.begin(), rows.begin() + 1, rows.end());
+            out.push_back(rows);
+        }
+        return out;
+    }();
+
+    const char* names[3] = {"adaptive", "full", "diff"};
+    for (auto* scene : {&snakeFrames, &scrollFrames}) {
+        const char* sceneName = (scene == &snakeFrames) ? "snake" : "scrolling";
+        for (int st = 0; st < 3; ++st) {
+            ScreenRenderer r;
+            r.setStrategy(static_cast<ScreenRenderer::Strategy>(st));
+            std::string out;
+            double ns = nsPerOp(frames, [&] {
+                for (const auto& f : *scene) {
+                    out.clear();
+                    r.render(f, out);
+                }
+            });
+            printBench(string("render ") + sceneName + " frame, " + names[st], ns);
+            cout << "    " << r.stats().bytes / r.stats().frames << " bytes/frame, " << r.stats().fullFrames
+                 << " of " << r.stats().frames << " frames full\n";
+
+            // The same output through the terminal model: what parsing it
+            // costs, and whether the screen matches every frame.
+            ScreenRenderer again;
+            again.setStrategy(static_cast<ScreenRenderer::Strategy>(st));
+            std::vector<std::string> outputs(scene->size());
+            for (size_t f = 0; f < scene->size(); ++f) again.render((*scene)[f], outputs[f]);
+            VirtualTerminal timed(HEIGHT + 2, WIDTH + 1);
+            double parse = nsPerOp(frames, [&] {
+                for (const auto& o : outputs) timed.feed(o);
+            });
+            VirtualTerminal vt(HEIGHT + 2, WIDTH + 1);
+            int wrong = 0;
+            for (size_t f = 0; f < scene->size(); ++f) {
+                vt.feed(outputs[f]);
+                if (!vt.shows((*scene)[f])) ++wrong;
+            }
+            printBench(string("  terminal parse, ") + names[st], parse);
+            if (wrong) cout << "    MISMATCH: " << wrong << " frames shown wrong\n";
+        }
+    }
+}
+
+// Two lockstep peers whose messages arrive `latency` ticks late, each
+// player changing direction now and then: the cost of a snapshot, of
+// replaying ten ticks and of the state hash, how often predictions fail,
+// and whether the peers still agree at the end.
+void benchRollback(int latency, int ticks) {
+    using Duel = DuelState<WIDTH, HEIGHT>;
+    Duel s;
+    s.reset(3);
+    std::array<Duel, 16> saved;
+    double copyNs = nsPerOp(100000, [&] {
+        for (int i = 0; i < 100000; ++i) saved[i & 15] = s;
+    });
+    printBench("duel snapshot copy", copyNs);
+    Rng rng{17};
+    std::vector<std::array<Direction, 2>> script(10);
+    for (auto& in : script) in = {static_cast<Direction>(rng.below(4)), static_cast<Direction>(rng.below(4))};
+    volatile uint64_t sink = 0;
+    double replayNs = nsPerOp(10000, [&] {
+        for (int i = 0; i < 10000; ++i) {
+            Duel d = saved[0];
+            for (const auto& in : script) d.step(in);
+            sink = sink + d.food;
+        }
+    });
+    printBench("duel rollback: restore + replay 10 ticks", replayNs);
+    double hashNs = nsPerOp(100000, [&] {
+        for (int i = 0; i < 100000; ++i) sink = sink + saved[i & 15].hash();
+    });
+    printBench("duel state hash", hashNs);
+
+    long long rollbacks = 0, replayed = 0, played = 0;
+    int deepest = 0, games = 0, desyncs = 0, disagreements = 0;
+    while (played < ticks) {
+        std::array<std::unique_ptr<Lockstep<WIDTH, HEIGHT>>, 2> peer;
+        for (int p = 0; p < 2; ++p) peer[p] = std::make_unique<Lockstep<WIDTH, HEIGHT>>(p, 100 + games);
+        std::array<std::deque<std::pair<long long, DuelMessage>>, 2> wire; // wire[p]: to peer p
+        std::array<Direction, 2> wanted = {peer[0]->state().snakes[0].dir, peer[1]->state().snakes[1].dir};
+        long long t = 0;
+        for (; t < 2000 && !(peer[0]->decided() && peer[1]->decided()); ++t) {
+            for (int p = 0; p < 2; ++p) {
+                auto& q = wire[p];
+                while (!q.empty() && q.front().first <= t) {
+                    peer[p]->receive(q.front().second);
+                    q.pop_front();
+                }
+                peer[p]->settle();
+                if (rng.below(6) == 0) wanted[p] = static_cast<Direction>(rng.below(4));
+                if (peer[p]->canAdvance()) wire[1 - p].push_back({t + latency, peer[p]->advance(wanted[p])});
+            }
+        }
+        // Deliver what is still on the wire, then both must agree.
+        for (int p = 0; p < 2; ++p) {
+            for (auto& m : wire[p]) peer[p]->receive(m.second);
+            peer[p]->settle();
+        }
+        for (int p = 0; p < 2; ++p) {
+            desyncs += peer[p]->desynced();
+            rollbacks += peer[p]->stats().rollbacks;
+            replayed += peer[p]->stats().resimulated;
+            deepest = std::max(deepest, peer[p]->stats().deepest);
+        }
+        const Duel &a = peer[0]->state(), &b = peer[1]->state();
+        if (a.tick == b.tick && a.hash() != b.hash()) ++disagreements;
+        played += t;
+        ++games;
+    }
+    cout << "  lockstep, " << latency << "-tick latency: " << games << " games, " << played << " ticks, " << rollbacks
+         << " rollbacks (" << replayed << " ticks replayed, deepest " << deepest << "), "
+         << (desyncs || disagreements ? "DESYNC" : string("peers agree")) << "\n";
+}
+
+#ifndef _WIN32
+// A terminal that drains only ~256 KB/s (a pipe with a slow reader) fed a
+// busy frame every millisecond: the longest time one tick spends on output,
+// through TerminalOutput and through plain blocking writes.
+void benchTerminalOutput() {
+    const int ticks = 500;
+    Rng rng{6};
+    std::vector<std::string> frame(HEIGHT, std::string(WIDTH, ' '));
+    auto nextFrame = [&] {
+        for (auto& row : frame)
+            for (char& c : row) c = (char)('a' + rng.below(26));
+    };
+    for (int mode = 0; mode < 2; ++mode) {
+        int fds[2];
+        if (pipe(fds) != 0) return;
+#ifdef F_SETPIPE_SZ
+        fcntl(fds[1], F_SETPIPE_SZ, 4096);
+#endif
+        std::atomic<bool> done{false};
+        std::thread reader([&] {
+            char buf[256];
+            while (true) {
+                ssize_t n = read(fds[0], buf, sizeof(buf));
+                if (n <= 0 && done) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        long long worst = 0, rendered = 0;
+        {
+            TerminalOutput out(fds[1]);
+            ScreenRenderer blockingRenderer;
+            std::string bytes;
+            if (mode == 0) out.begin();
+            for (int t = 0; t < ticks; ++t) {
+                nextFrame();
+                auto t0 = std::chrono::steady_clock::now();
+                if (mode == 0) {
+                    out.submit(frame);
+                } else {
+                    bytes.clear();
+                    blockingRenderer.render(frame, bytes);
+                    for (size_t off = 0; off < bytes.size();) {
+                        ssize_t n = write(fds[1], bytes.data() + off, bytes.size() - off);
+                        if (n > 0) off += n;
+                        else if (errno != EINTR) break;
+                    }
+                    ++rendered;
+                }
+                auto spent = std::chrono::steady_clock::now() - t0;
+                worst = std::max<long long>(worst, std::chrono::duration_cast<std::chrono::microseconds>(spent).count());
+                std::this_thread::sleep_for(std::chrono::milliseconds(1) - spent);
+                if (mode == 0) out.pump();
+            }
+            if (mode == 0) {
+                out.end();
+                rendered = out.stats().rendered;
+            }
+        }
+        done = true;
+        close(fds[1]);
+        reader.join();
+        close(fds[0]);
+        cout << "  slow terminal, " << (mode == 0 ? "non-blocking + coalescing" : "blocking writes")
+             << ": longest tick on output " << worst << " us, " << rendered << " of " << ticks << " frames sent\n";
+    }
+}
+
+// The game loop's terminal I/O alone, against pipes standing in for the
+// terminal: the game's 120 ms tick, a small frame change per tick and a key
+// every 50 ms, under each I/O backend.
+void benchIoBackends() {
+    const int ticks = 15, tickMs = 120;
+    for (IoMode wanted : {IoMode::CLASSIC, IoMode::POLL, IoMode::URING}) {
+        int in[2], out[2];
+        if (pipe(in) != 0) return;
+        if (pipe(out) != 0) return;
+        std::atomic<bool> done{false};
+        std::thread keys([&] {
+            while (!done) {
+                if (write(in[1], "w", 1) != 1) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        });
+        std::thread reader([&] {
+            char buf[4096];
+            while (read(out[0], buf, sizeof(buf)) > 0) {}
+        });
+        long long calls = 0, keysSeen = 0;
+        IoMode used;
+        {
+            TerminalIo io(in[0], out[1]);
+            used = io.open(wanted);
+            TerminalOutput screen(out[1]);
+            screen.setIo(&io);
+            screen.begin();
+            std::vector<std::string> frame(HEIGHT, std::string(WIDTH, ' '));
+            auto last = std::chrono::steady_clock::now();
+            for (int t = 0; t < ticks;) {
+                while (io.getKey() != -1) ++keysSeen;
+                screen.pump();
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last).count();
+                if (elapsed >= tickMs) {
+                    frame[t % HEIGHT][t % WIDTH] ^= 'O' ^ ' ';
+                    screen.submit(frame);
+                    last = std::chrono::steady_clock::now();
+                    elapsed = 0;
+                    ++t;
+                }
+                io.wait(tickMs - (int)elapsed);
+            }
+            screen.end();
+            calls = io.syscalls();
+        }
+        done = true;
+        keys.join();
+        close(out[1]);
+        reader.join();
+        close(out[0]);
+        close(in[0]);
+        close(in[1]);
+        cout << "  terminal I/O, " << std::left << std::setw(9) << ioModeName(used) << std::right << std::fixed
+             << std::setprecision(1) << std::setw(6) << (double)calls / ticks << " syscalls/tick (" << keysSeen
+             << " keys)\n";
+    }
+}
+
+// The game's own output (draw() through TerminalOutput, escapes and all)
+// into two terminal models, from two games with the same seed: one
+// rendering adaptively, one always repainting. The screens must agree
+// after every tick.
+void benchGameScreen(int ticks) {
+    struct Player {
+        int sv[2] = {-1, -1};
+        std::unique_ptr<SnakeGame<WrapAround>> game;
+        VirtualTerminal vt;
+        long long bytes = 0;
+    };
+    Player players[2];
+    const ScreenRenderer::Strategy strategies[2] = {ScreenRenderer::Strategy::ADAPTIVE,
+                                                    ScreenRenderer::Strategy::ALWAYS_FULL};
+    for (int i = 0; i < 2; ++i) {
+        Player& p = players[i];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, p.sv) != 0) return;
+        fcntl(p.sv[1], F_SETFL, fcntl(p.sv[1], F_GETFL) | O_NONBLOCK);
+        p.game = std::make_unique<SnakeGame<WrapAround>>(p.sv[0], p.sv[0]);
+        p.game->setAutopilot(Autopilot::GREEDY);
+        p.game->setRenderStrategy(strategies[i]);
+        p.game->reset(11);
+        p.game->attach();
+    }
+    auto settle = [](Player& p) {
+        char buf[8192];
+        while (true) {
+            bool done = p.game->flush();
+            for (ssize_t n; (n = read(p.sv[1], buf, sizeof(buf))) > 0;) {
+                p.vt.feed(buf, (size_t)n);
+                p.bytes += n;
+            }
+            if (done) return;
+        }
+    };
+    int wrong = 0, games = 1;
+    for (int t = 0; t < ticks; ++t) {
+        for (Player& p : players) {
+            if (p.game->over()) p.game->reset(11 + games);
+            p.game->step();
+            settle(p);
+        }
+        if (players[0].game->over()) ++games;
+        if (!players[0].vt.sameScreen(players[1].vt)) ++wrong;
+    }
+    for (Player& p : players) {
+        p.game->detach();
+        settle(p);
+        p.game.reset();
+        close(p.sv[0]);
+        close(p.sv[1]);
+    }
+    cout << "  game output, " << ticks << " ticks: " << players[0].bytes / ticks << " bytes/tick adaptive, "
+         << players[1].bytes / ticks << " always full; "
+         << (wrong ? "MISMATCH on " + to_string(wrong) + " ticks" : string("screens identical")) << "\n";
+}
+
+// Greedy games with the board packed with food and power-ups: the food
+// count --food asked for must hold after every tick, including the ticks
+// where the state's own new food lands on an item.
+void benchFoodCount(int ticks) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return;
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+    {
+        SnakeGame<WrapAround> game(sv[0], sv[0]);
+        game.setAutopilot(Autopilot::GREEDY);
+        game.setItems(MAX_FOOD, true);
+        game.reset(21);
+        game.attach();
+        auto drain = [&] {
+            char buf[8192];
+            while (true) {
+                bool done = game.flush();
+                while (read(sv[1], buf, sizeof(buf)) > 0) {}
+                if (done) return;
+            }
+        };
+        int wrong = 0, games = 1, longest = 0;
+        for (int t = 0; t < ticks; ++t) {
+            if (game.over()) game.reset(21 + games++);
+            game.step();
+            drain();
+            longest = std::max(longest, game.length());
+            if (!game.over() && game.itemCount(ItemKind::FOOD) + 1 != MAX_FOOD) ++wrong;
+        }
+        game.detach();
+        drain();
+        cout << "  --food " << MAX_FOOD << ", " << ticks << " ticks (" << games << " games, longest snake " << longest
+             << "): " << (wrong ? "food count WRONG on " + to_string(wrong) + " ticks" : string("food count held")) << "\n";
+    }
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// The tick side of autosaving (snapshot and hand-off) while the writer
+// fsyncs in the background, and a save read back into a second game.
+void benchAutosave() {
+    using Game = SnakeGame<WrapAround>;
+    char dir[] = "/tmp/snake_bench_XXXXXX";
+    if (!mkdtemp(dir)) return;
+    string path = string(dir) + "/bench.save";
+    Game game;
+    game.setAutopilot(Autopilot::GREEDY);
+    game.setItems(4, true);
+    game.reset(5);
+    const int saves = 20000;
+    long long worst = 0, written;
+    double ns;
+    {
+        Autosaver<Game::Save> saver(path);
+        ns = nsPerOp(saves, [&] {
+            for (int i = 0; i < saves; ++i) {
+                auto t0 = std::chrono::steady_clock::now();
+                game.snapshot(saver.next());
+                saver.commit();
+                auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0);
+                worst = std::max<long long>(worst, t.count());
+            }
+        });
+        written = saver.saved(); // the destructor still writes the last one
+    }
+    auto saved = std::make_unique<Game::Save>();
+    Game copy;
+    bool same = loadSave(path, *saved);
+    if (same) {
+        copy.restore(*saved);
+        same = copy.stateHash() == game.stateHash() && copy.score() == game.score();
+    }
+    remove(path.c_str());
+    rmdir(dir);
+    printBench("autosave snapshot + hand-off", ns);
+    cout << "    slowest " << worst / 1000.0 << " us, " << written << " of " << saves << " reached the disk (the rest were superseded), "
+         << (same ? "restored game matches" : "RESTORE MISMATCH") << "\n";
+}
+
+// Heap bytes in use, -1 where the allocator cannot say. (The resident set
+// is no use here: earlier benchmarks leave freed heap behind to reuse.)
+long long heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return (long long)mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+// One kiosk host serving many players over socket pairs, each steered by
+// the greedy autopilot: cost per session tick, how often the loop wakes,
+// memory per session and the context switches of the whole run.
+void benchKioskHost(int players, int ms) {
+    KioskHost<WrapAround> host;
+    host.setAutopilot(Autopilot::GREEDY);
+    std::vector<int> clients;
+    long long memBefore = heapInUse();
+    for (int i = 0; i < players; ++i) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) break;
+        host.adopt(sv[0], true);
+        clients.push_back(sv[1]);
+        fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+        if (write(sv[1], " ", 1) != 1) break; // leave the title line
+    }
+    // The players' terminals: read everything each session sends.
+    std::atomic<bool> done{false};
+    std::thread screens([&] {
+        std::vector<struct pollfd> p;
+        for (int fd : clients) p.push_back({fd, POLLIN, 0});
+        char buf[4096];
+        while (!done) {
+            if (poll(p.data(), p.size(), 50) <= 0) continue;
+            for (auto& e : p) {
+                if (e.revents & POLLIN) while (read(e.fd, buf, sizeof(buf)) > 0) {}
+            }
+        }
+    });
+    struct rusage before, after;
+    getrusage(RUSAGE_THREAD, &before);
+    host.run(ms);
+    getrusage(RUSAGE_THREAD, &after);
+    long long memAfter = heapInUse(); // after play, when every session has drawn
+    done = true;
+    screens.join();
+    for (int fd : clients) close(fd);
+
+    auto micros = [](const struct timeval& tv) { return tv.tv_sec * 1000000LL + tv.tv_usec; };
+    long long cpu = micros(after.ru_utime) - micros(before.ru_utime) + micros(after.ru_stime) - micros(before.ru_stime);
+    long long switches = (after.ru_nvcsw - before.ru_nvcsw) + (after.ru_nivcsw - before.ru_nivcsw);
+    auto st = host.stats();
+    cout << "  kiosk host, " << clients.size() << " players for " << ms << " ms: " << st.ticks << " ticks, "
+         << std::fixed << std::setprecision(1) << (double)cpu / std::max(1LL, st.ticks) << " us CPU per tick, "
+         << st.wakeups << " wakeups, " << switches << " context switches";
+    if (memBefore >= 0 && memAfter >= 0) {
+        cout << ", " << (double)(memAfter - memBefore) / 1024 / std::max<size_t>(1, clients.size()) << " KiB heap per player";
+    }
+    cout << "\n";
+}
+#endif
+
+void runBenchmarks() {
+    cout << "Snake benchmarks\n";
+    benchStep<WIDTH, HEIGHT>();
+    benchStep<512, 512>();
+    benchFloodFill<WIDTH, HEIGHT>(0.1);
+    benchFloodFill<512, 512>(0.1);
+    benchFloodFill<512, 512>(0.4);
+    benchDistanceField<256, 256>(2000, 20000);
+    benchStateClone<WIDTH, HEIGHT>();
+    benchStateClone<512, 512>();
+    benchExpectimax(40);
+    benchHeadlessStep<WrapAround>();
+    benchHeadlessStep<SolidWalls>();
+    benchHeadlessStep<Portals>();
+    benchZobrist();
+    benchNeuralForward();
+    benchDatasetLog();
+#ifndef _WIN32
+    benchTelemetry();
+#endif
+    benchItems<4096, 4096>(2000000);
+    benchRenderer();
+    benchRollback(3, 20000);
+#ifndef _WIN32
+    benchTerminalOutput();
+    benchIoBackends();
+    benchGameScreen(2000);
+    benchFoodCount(20000);
+    benchAutosave();
+    benchKioskHost(256, 2000);
+#endif
+}
+
+void printUsage() {
+    cout << "Usage: snake_game [--autopilot [greedy|expectimax|neural]] [--genome FILE]\n"
+            "       snake_game --train [GENERATIONS [POPULATION]] [--genome FILE]\n"
+            "       snake_game --bench\n"
+            "       snake_game --analyze [GAMES] [--autopilot greedy|neural] [--boundary ...]\n"
+            "       snake_game --dataset-stats FILE\n"
+            "       snake_game --host-socket PATH | --host-ptys N   (one process, many terminals)\n"
+            "       snake_game --duel-host PATH | --duel-join PATH  (two players, one socket)\n"
+            "Play options: --log-dataset FILE records every tick for imitation learning,\n"
+            "              --food N keeps N food items on the board (1 to " << MAX_FOOD << "),\n"
+            "              --powerups adds timed power-ups,\n"
+            "              --boundary wrap|walls|portals picks what the board's edges do,\n"
+            "              --io classic|poll|uring picks the terminal I/O backend and reports its syscalls,\n"
+            "              --telemetry NAME publishes per-tick metrics to watch with snake_monitor NAME,\n"
+            "              --autosave FILE keeps the game in FILE and resumes it after a crash\n"
+            "              (kiosk terminal N uses FILE.N).\n";
+}
+
+// Optional numeric argument following a flag.
+bool nextNumber(int argc, char* argv[], int& i, int& out) {
+    if (i + 1 >= argc || !isdigit((unsigned char)argv[i + 1][0])) return false;
+    out = atoi(argv[++i]);
+    return true;
+}
+
+struct PlayOptions {
+    Autopilot autopilot = Autopilot::OFF;
+    string genomePath = "snake_genome.bin";
+    string datasetPath;
+    int foodCount = 1;
+    bool powerUps = false;
+    IoMode io = IoMode::CLASSIC;
+    bool reportIo = false;
+    string hostSocket; // kiosk host: where players connect
+    int hostPtys = 0;  // kiosk host: pseudo-terminals to open
+    string duelSocket; // two-player duel: where the players meet
+    bool duelHosting = false;
+    string telemetryName; // shared memory for snake_monitor
+    string autosavePath;  // where an interrupted game is kept
+};
+
+#ifndef _WIN32
+std::atomic<bool> hostStop{false};
+void stopHost(int) { hostStop = true; }
+
+template <typename Boundary>
+int host(const PlayOptions& options) {
+    KioskHost<Boundary> kiosk;
+    kiosk.setItems(options.foodCount, options.powerUps);
+    kiosk.setAutosave(options.autosavePath);
+    if (!options.hostSocket.empty()) {
+        if (!kiosk.listenOn(options.hostSocket)) {
+            cout << "Cannot listen on " << options.hostSocket << "\n";
+            return 1;
+        }
+        cout << "Players connect with: socat -,raw,echo=0 UNIX-CONNECT:" << options.hostSocket << "\n";
+    }
+    for (int i = 0; i < options.hostPtys; ++i) {
+        string path = kiosk.openPty();
+        if (path.empty()) {
+            cout << "Cannot open a pseudo-terminal\n";
+            return 1;
+        }
+        cout << "Kiosk terminal " << i + 1 << ": " << path << "\n";
+    }
+    struct sigaction sa = {};
+    sa.sa_handler = stopHost;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    cout << "Serving; Ctrl-C stops." << endl;
+    kiosk.run(-1, &hostStop);
+    auto st = kiosk.stats();
+    cout << "\n" << st.opened << " sessions, " << st.ticks << " ticks, " << st.wakeups << " wakeups\n";
+    return 0;
+}
+#endif
+
+#ifndef _WIN32
+// The first bytes on a duel socket, from the hosting side.
+struct DuelHello {
+    uint64_t seed;
+    char boundary[8];
+};
+
+template <typename Boundary>
+int duel(const PlayOptions& options) {
+    struct sockaddr_un addr = {};
+    if (options.duelSocket.size() >= sizeof(addr.sun_path)) {
+        cout << "Socket path too long\n";
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, options.duelSocket.c_str(), options.duelSocket.size() + 1);
+    int sock = -1;
+    DuelHello hello = {};
+    if (options.duelHosting) {
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(addr.sun_path);
+        if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0) {
+            cout << "Cannot listen on " << options.duelSocket << "\n";
+            return 1;
+        }
+        cout << "Waiting for the other player (snake_game --duel-join " << options.duelSocket << ")..." << endl;
+        sock = accept(listener, nullptr, nullptr);
+        close(listener);
+        unlink(addr.sun_path);
+        std::random_device rd;
+        hello.seed = ((uint64_t)rd() << 32) | rd();
+        snprintf(hello.boundary, sizeof(hello.boundary), "%s", Boundary::NAME);
+        if (sock < 0 || send(sock, &hello, sizeof(hello), MSG_NOSIGNAL) != (ssize_t)sizeof(hello)) {
+            cout << "The other player could not join\n";
+            return 1;
+        }
+    } else {
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+            recv(sock, &hello, sizeof(hello), MSG_WAITALL) != (ssize_t)sizeof(hello)) {
+            cout << "Cannot join a duel at " << options.duelSocket << "\n";
+            return 1;
+        }
+        if (strncmp(hello.boundary, Boundary::NAME, sizeof(hello.boundary)) != 0) {
+            cout << "The other player uses --boundary " << string(hello.boundary, strnlen(hello.boundary, 8)) << "\n";
+            close(sock);
+            return 1;
+        }
+    }
+    DuelGame<Boundary> game(sock, options.duelHosting ? 0 : 1, hello.seed);
+    game.run();
+    close(sock);
+    return 0;
+}
+#endif
+
+// --analyze: bot games on all cores, a report and two heatmaps.
+template <typename Boundary>
+int analyze(const PlayOptions& options, long long games) {
+    std::unique_ptr<NeuralNet> net;
+    if (options.autopilot == Autopilot::NEURAL) {
+        net = std::make_unique<NeuralNet>();
+        if (!loadGenome(*net, options.genomePath)) {
+            cout << "Cannot load genome " << options.genomePath << " (train one with --train)\n";
+            return 1;
+        }
+    } else if (options.autopilot == Autopilot::EXPECTIMAX) {
+        cout << "--analyze plays the greedy or neural autopilot\n";
+        return 1;
+    }
+    cout << "Analysing " << games << " " << (net ? "neural" : "greedy") << " games on a " << WIDTH << "x" << HEIGHT
+         << " " << Boundary::NAME << " board..." << endl;
+    auto start = std::chrono::steady_clock::now();
+    GameStats<WIDTH, HEIGHT> st = GameAnalyzer<WIDTH, HEIGHT, Boundary>(net.get()).run(games, std::random_device{}());
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << st.games << " games, " << st.ticks << " ticks in " << std::fixed << std::setprecision(1) << secs << " s ("
+         << st.ticks / secs / 1e6 << " M ticks/s)\n";
+    printGameStats(st);
+    const char* heads = "snake_heads.pgm";
+    const char* deaths = "snake_deaths.pgm";
+    if (writeHeatmap(heads, WIDTH, HEIGHT, st.headVisits) && writeHeatmap(deaths, WIDTH, HEIGHT, st.deaths)) {
+        cout << "Heatmaps: " << heads << " (head visits), " << deaths << " (where games ended)\n";
+    } else {
+        cout << "Cannot write heatmaps\n";
+        return 1;
+    }
+    return 0;
+}
+
+template <typename Boundary>
+int play(const PlayOptions& options) {
+#ifndef _WIN32
+    if (!options.hostSocket.empty() || options.hostPtys > 0) return host<Boundary>(options);
+    if (!options.duelSocket.empty()) return duel<Boundary>(options);
+#endif
+    SnakeGame<Boundary> game;
+    game.setAutopilot(options.autopilot);
+    game.setItems(options.foodCount, options.powerUps);
+    game.setIoMode(options.io, options.reportIo);
+    game.reset();
+    if (options.autopilot == Autopilot::NEURAL) {
+        NeuralNet net;
+        if (!loadGenome(net, options.genomePath)) {
+            cout << "Cannot load genome " << options.genomePath << " (train one with --train)\n";
+            return 1;
+        }
+        game.setNeuralNet(net);
+    }
+    std::unique_ptr<DatasetLogger> dataset;
+    if (!options.datasetPath.empty()) {
+        FILE* f = fopen(options.datasetPath.c_str(), "wb");
+        if (!f) {
+            cout << "Cannot write dataset " << options.datasetPath << "\n";
+            return 1;
+        }
+        dataset = std::make_unique<DatasetLogger>(f, WIDTH, HEIGHT);
+        game.setDatasetLogger(dataset.get());
+    }
+    std::unique_ptr<Autosaver<typename SnakeGame<Boundary>::Save>> autosave;
+    if (!options.autosavePath.empty()) {
+        auto saved = std::make_unique<typename SnakeGame<Boundary>::Save>();
+        if (loadSave(options.autosavePath, *saved)) game.restore(*saved);
+        autosave = std::make_unique<Autosaver<typename SnakeGame<Boundary>::Save>>(options.autosavePath);
+        game.setAutosave(autosave.get());
+    }
+    TelemetryWriter telemetry;
+    if (!options.telemetryName.empty()) {
+        if (!telemetry.create(options.telemetryName)) {
+            cout << "Cannot create shared memory " << telemetryShmName(options.telemetryName) << "\n";
+            return 1;
+        }
+        game.setTelemetry(&telemetry);
+    }
+    // intro with name entry + typing animation, then the game, on one event loop
+    Scheduler scheduler(game.openConsole());
+    scheduler.spawn(game.session(scheduler));
+    scheduler.run();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    PlayOptions options;
+    string boundary = "wrap";
+    bool train = false;
+    int generations = 50, populationSize = 2000;
+    int analyzeGames = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--bench") {
+            runBenchmarks();
+            return 0;
+        } else if (arg == "--autopilot") {
+            options.autopilot = Autopilot::GREEDY;
+            string mode = (i + 1 < argc) ? argv[i + 1] : "";
+            if (mode == "greedy" || mode == "expectimax" || mode == "neural") ++i;
+            if (mode == "expectimax") options.autopilot = Autopilot::EXPECTIMAX;
+            if (mode == "neural") options.autopilot = Autopilot::NEURAL;
+        } else if (arg == "--train") {
+            train = true;
+            if (nextNumber(argc, argv, i, generations)) nextNumber(argc, argv, i, populationSize);
+        } else if (arg == "--analyze") {
+            analyzeGames = 100000;
+            nextNumber(argc, argv, i, analyzeGames);
+        } else if (arg == "--dataset-stats" && i + 1 < argc) {
+            return datasetStats(argv[i + 1]);
+        } else if (arg == "--log-dataset" && i + 1 < argc) {
+            options.datasetPath = argv[++i];
+        } else if (arg == "--telemetry" && i + 1 < argc) {
+            options.telemetryName = argv[++i];
+        } else if (arg == "--autosave" && i + 1 < argc) {
+            options.autosavePath = argv[++i];
+        } else if (arg == "--food") {
+            if (!nextNumber(argc, argv, i, options.foodCount)) {
+                printUsage();
+                return 1;
+            }
+            if (options.foodCount < 1 || options.foodCount > MAX_FOOD) {
+                cout << "--food takes 1 to " << MAX_FOOD << " items on a " << WIDTH << "x" << HEIGHT << " board\n";
+                return 1;
+            }
+        } else if (arg == "--powerups") {
+            options.powerUps = true;
+        } else if (arg == "--io" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode != "classic" && mode != "poll" && mode != "uring") {
+                printUsage();
+                return 1;
+            }
+            options.io = mode == "uring" ? IoMode::URING : mode == "poll" ? IoMode::POLL : IoMode::CLASSIC;
+            options.reportIo = true;
+        } else if (arg == "--boundary" && i + 1 < argc) {
+            boundary = argv[++i];
+            if (boundary != WrapAround::NAME && boundary != SolidWalls::NAME && boundary != Portals::NAME) {
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--host-socket" && i + 1 < argc) {
+            options.hostSocket = argv[++i];
+        } else if ((arg == "--duel-host" || arg == "--duel-join") && i + 1 < argc) {
+            options.duelHosting = arg == "--duel-host";
+            options.duelSocket = argv[++i];
+        } else if (arg == "--host-ptys") {
+            if (!nextNumber(argc, argv, i, options.hostPtys)) {
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--genome" && i + 1 < argc) {
+            options.genomePath = argv[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (train) {
+        Trainer<WIDTH, HEIGHT> trainer(std::max(2, populationSize), std::random_device{}());
+        trainer.run(generations, options.genomePath);
+        return 0;
+    }
+
+    if (analyzeGames > 0) {
+        if (boundary == SolidWalls::NAME) return analyze<SolidWalls>(options, analyzeGames);
+        if (boundary == Portals::NAME) return analyze<Portals>(options, analyzeGames);
+        return analyze<WrapAround>(options, analyzeGames);
+    }
+    if (boundary == SolidWalls::NAME) return play<SolidWalls>(options);
+    if (boundary == Portals::NAME) return play<Portals>(options);
+    return play<WrapAround>(options);
 }
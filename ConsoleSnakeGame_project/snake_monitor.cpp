@@ -0,0 +1,141 @@
+// snake_monitor.cpp
+// Watches a snake_game started with --telemetry NAME from another terminal:
+// reads the game's shared-memory ring (snake_telemetry.h) and prints one
+// line per interval with tick rate, tick cost, output per tick, input
+// latency, score and length. Reading never slows the game down.
+// Usage: snake_monitor [NAME] [--every MS] [--raw]
+//   NAME      as given to --telemetry (default: snake)
+//   --every   interval between summary lines (default: 1000)
+//   --raw     one line per tick instead of summaries
+// Build: g++ -std=c++17 -O2 snake_monitor.cpp -o snake_monitor
+
+#include "snake_telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+  #include <cerrno>
+  #include <csignal>
+#endif
+
+using namespace std;
+
+struct Summary {
+    long long ticks = 0, missed = 0;
+    long long tickUs = 0, maxTickUs = 0;
+    long long bytes = 0;
+    long long keys = 0, latencyUs = 0, maxLatencyUs = 0;
+    TelemetrySample last = {};
+
+    void add(const TelemetrySample& s) {
+        ++ticks;
+        tickUs += s.tickUs;
+        maxTickUs = max<long long>(maxTickUs, s.tickUs);
+        bytes += s.frameBytes;
+        if (s.inputLatencyUs) {
+            ++keys;
+            latencyUs += s.inputLatencyUs;
+            maxLatencyUs = max<long long>(maxLatencyUs, s.inputLatencyUs);
+        }
+        last = s;
+    }
+};
+
+void printHeader() {
+    printf("%8s %7s %9s %9s %10s %15s %7s %6s %6s\n", "tick", "ticks/s", "avg us", "max us", "bytes/tick",
+           "key lat avg/max", "score", "length", "missed");
+}
+
+void printSummary(const Summary& s, double seconds) {
+    char latency[32] = "-";
+    if (s.keys) {
+        snprintf(latency, sizeof(latency), "%.1f/%.1f ms", s.latencyUs / 1000.0 / s.keys, s.maxLatencyUs / 1000.0);
+    }
+    printf("%8u %7.1f %9.1f %9lld %10.0f %15s %7d %6u %6lld\n", s.last.tick, s.ticks / seconds,
+           s.ticks ? (double)s.tickUs / s.ticks : 0.0, s.maxTickUs, s.ticks ? (double)s.bytes / s.ticks : 0.0, latency,
+           s.last.score, s.last.length, s.missed);
+    fflush(stdout);
+}
+
+void printSample(const TelemetrySample& s) {
+    printf("tick %u: %u us, %u bytes, key latency %u us, score %d, length %u\n", s.tick, s.tickUs, s.frameBytes,
+           s.inputLatencyUs, s.score, s.length);
+}
+
+bool gameRunning(uint32_t pid) {
+#ifndef _WIN32
+    return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+#else
+    (void)pid;
+    return true;
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    string name = "snake";
+    int everyMs = 1000;
+    bool raw = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--every" && i + 1 < argc) {
+            everyMs = max(10, atoi(argv[++i]));
+        } else if (arg == "--raw") {
+            raw = true;
+        } else if (arg[0] != '-') {
+            name = arg;
+        } else {
+            cout << "Usage: snake_monitor [NAME] [--every MS] [--raw]\n";
+            return 1;
+        }
+    }
+
+    TelemetryReader reader;
+    if (!reader.open(name)) {
+        cout << "Waiting for snake_game --telemetry " << name << "..." << endl;
+        while (!reader.open(name)) this_thread::sleep_for(chrono::milliseconds(500));
+    }
+    cout << "Watching game " << reader.pid() << " (" << telemetryShmName(name) << ")" << endl;
+    if (!raw) printHeader();
+
+    // Start at the present rather than replaying the ring's history.
+    uint64_t next = reader.published();
+    auto since = chrono::steady_clock::now();
+    Summary summary;
+    while (true) {
+        this_thread::sleep_for(chrono::milliseconds(raw ? min(everyMs, 50) : everyMs));
+        uint64_t published = reader.published();
+        if (next < reader.oldest()) {
+            summary.missed += (long long)(reader.oldest() - next);
+            next = reader.oldest();
+        }
+        for (; next < published; ++next) {
+            TelemetrySample s;
+            if (!reader.read(next, s)) {
+                ++summary.missed; // overwritten while we were reading
+                continue;
+            }
+            if (raw) printSample(s);
+            else summary.add(s);
+        }
+        if (raw) {
+            fflush(stdout);
+        } else {
+            auto now = chrono::steady_clock::now();
+            printSummary(summary, chrono::duration<double>(now - since).count());
+            TelemetrySample last = summary.last; // score and length carry over quiet intervals
+            summary = Summary();
+            summary.last = last;
+            since = now;
+        }
+        if (!gameRunning(reader.pid())) {
+            cout << "Game " << reader.pid() << " has exited\n";
+            return 0;
+        }
+    }
+}
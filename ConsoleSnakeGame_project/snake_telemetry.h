@@ -0,0 +1,201 @@
+// snake_telemetry.h
+// Live per-tick metrics from snake_game (--telemetry NAME) to snake_monitor,
+// through a ring in POSIX shared memory. The game is the only writer and
+// never waits for a reader or does I/O for one: publishing a tick is a few
+// stores into the next slot. Any number of monitors can read at once.
+//
+// Every slot has a sequence number that is odd while the game writes it
+// (a per-slot seqlock), so a monitor that falls a whole ring behind sees
+// that a slot was overwritten and skips it rather than reading half a tick.
+#ifndef SNAKE_TELEMETRY_H
+#define SNAKE_TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+struct TelemetrySample {
+    uint32_t tick;
+    uint32_t tickUs;         // time spent on the tick: step, frame and write
+    uint32_t frameBytes;     // written to the terminal since the previous tick
+    uint32_t inputLatencyUs; // first key read -> frame showing it; 0 if no key
+    int32_t score;
+    uint32_t length;
+};
+
+struct TelemetrySlot {
+    std::atomic<uint64_t> seq; // 2n + 1 while sample n is written, 2n + 2 after
+    std::atomic<uint32_t> tick, tickUs, frameBytes, inputLatencyUs, length;
+    std::atomic<int32_t> score;
+};
+
+struct TelemetryRing {
+    static constexpr uint32_t MAGIC = 0x544B4E53; // "SNKT"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t SLOTS = 1024; // two minutes at the normal tick
+
+    uint32_t magic, version, slots, pid;
+    alignas(64) std::atomic<uint64_t> published; // samples written so far
+    alignas(64) TelemetrySlot slot[SLOTS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "the ring is shared between processes, so its atomics must not hide a lock");
+
+// Shared memory object names start with a slash; let people leave it out.
+inline std::string telemetryShmName(const std::string& name) {
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+// The game's end: creates the ring and removes it again when done.
+class TelemetryWriter {
+public:
+    TelemetryWriter() = default;
+    ~TelemetryWriter() { close(); }
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    // False where there is no POSIX shared memory or it cannot be created.
+    bool create(const std::string& name) {
+#ifndef _WIN32
+        close();
+        std::string shm = telemetryShmName(name);
+        // A game still running under this name keeps its ring, now unnamed;
+        // truncating that one instead would crash it.
+        shm_unlink(shm.c_str());
+        int fd = shm_open(shm.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) return false;
+        void* p = MAP_FAILED;
+        if (ftruncate(fd, sizeof(TelemetryRing)) == 0) {
+            p = mmap(nullptr, sizeof(TelemetryRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            shm_unlink(shm.c_str());
+            return false;
+        }
+        ring = static_cast<TelemetryRing*>(p); // zero-filled by ftruncate()
+        ring->version = TelemetryRing::VERSION;
+        ring->slots = TelemetryRing::SLOTS;
+        ring->pid = (uint32_t)getpid();
+        std::atomic_thread_fence(std::memory_order_release);
+        ring->magic = TelemetryRing::MAGIC;
+        shmName = shm;
+        next = 0;
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    bool active() const { return ring != nullptr; }
+
+    void publish(const TelemetrySample& s) {
+        uint64_t n = next++;
+        TelemetrySlot& slot = ring->slot[n % TelemetryRing::SLOTS];
+        slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release); // the odd seq lands before any field
+        slot.tick.store(s.tick, std::memory_order_relaxed);
+        slot.tickUs.store(s.tickUs, std::memory_order_relaxed);
+        slot.frameBytes.store(s.frameBytes, std::memory_order_relaxed);
+        slot.inputLatencyUs.store(s.inputLatencyUs, std::memory_order_relaxed);
+        slot.score.store(s.score, std::memory_order_relaxed);
+        slot.length.store(s.length, std::memory_order_relaxed);
+        slot.seq.store(2 * n + 2, std::memory_order_release);
+        ring->published.store(n + 1, std::memory_order_release);
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (!ring) return;
+        munmap(ring, sizeof(TelemetryRing));
+        shm_unlink(shmName.c_str());
+        ring = nullptr;
+#endif
+    }
+
+private:
+    TelemetryRing* ring = nullptr;
+    std::string shmName;
+    uint64_t next = 0;
+};
+
+// A monitor's end: maps the ring read-only.
+class TelemetryReader {
+public:
+    TelemetryReader() = default;
+    ~TelemetryReader() { close(); }
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    // False if no game publishes under `name` (or an incompatible one does).
+    bool open(const std::string& name) {
+#ifndef _WIN32
+        close();
+        int fd = shm_open(telemetryShmName(name).c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(TelemetryRing)) {
+            p = mmap(nullptr, sizeof(TelemetryRing), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        ring = static_cast<const TelemetryRing*>(p);
+        if (ring->magic != TelemetryRing::MAGIC || ring->version != TelemetryRing::VERSION ||
+            ring->slots != TelemetryRing::SLOTS) {
+            close();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    uint32_t pid() const { return ring->pid; }
+    uint64_t published() const { return ring->published.load(std::memory_order_acquire); }
+    // The oldest sample still in the ring.
+    uint64_t oldest() const {
+        uint64_t n = published();
+        return n > TelemetryRing::SLOTS ? n - TelemetryRing::SLOTS : 0;
+    }
+
+    // Copies sample n; false if it is not published yet, or was overwritten
+    // before or while it was copied.
+    bool read(uint64_t n, TelemetrySample& out) const {
+        const TelemetrySlot& slot = ring->slot[n % TelemetryRing::SLOTS];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * n + 2) return false;
+        out.tick = slot.tick.load(std::memory_order_relaxed);
+        out.tickUs = slot.tickUs.load(std::memory_order_relaxed);
+        out.frameBytes = slot.frameBytes.load(std::memory_order_relaxed);
+        out.inputLatencyUs = slot.inputLatencyUs.load(std::memory_order_relaxed);
+        out.score = slot.score.load(std::memory_order_relaxed);
+        out.length = slot.length.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire); // the fields are read before seq is checked again
+        return slot.seq.load(std::memory_order_relaxed) == seq;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (ring) munmap(const_cast<TelemetryRing*>(ring), sizeof(TelemetryRing));
+        ring = nullptr;
+#endif
+    }
+
+private:
+    const TelemetryRing* ring = nullptr;
+};
+
+#endif // SNAKE_TELEMETRY_H
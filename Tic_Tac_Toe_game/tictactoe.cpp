@@ -1,10 +1,36 @@
 // tictactoe.cpp
 // Simple Tic-Tac-Toe console game in C++ (Styled version)
-// Supports: 2-player or Human vs Computer (AI using Minimax)
+// Supports: 2-player or Human vs Computer (AI using Minimax), Quantum Tic-Tac-Toe,
+// and k-in-a-row for up to 4 players on larger boards
+// Games can be recorded (--record FILE [--binary]), record files bulk-parsed
+// for analysis (--parse FILE), and move scripts played in bulk (--script).
+// Rules and Minimax search come from the embeddable engine in ttt_engine.h/.cpp.
+// Build: g++ -std=c++17 -O2 -DTTT_ENGINE_STATIC tictactoe.cpp ttt_engine.cpp -o tictactoe
 
 #include <iostream>
 #include <vector>
 #include <limits>
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "ttt_engine.h"
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
 using namespace std;
 
 const char HUMAN = 'X';
@@ -26,91 +52,33 @@ void printBoard(const vector<char>& board) {
     cout << "\n";
 }
 
-bool isMovesLeft(const vector<char>& board) {
-    for (char c : board) if (c == EMPTY) return true;
-    return false;
-}
-
-int evaluate(const vector<char>& b) {
-    // Rows
-    for (int row = 0; row < 3; ++row) {
-        if (b[row*3] == b[row*3 + 1] && b[row*3 + 1] == b[row*3 + 2]) {
-            if (b[row*3] == COMPUTER) return +10;
-            else if (b[row*3] == HUMAN) return -10;
-        }
-    }
-    // Columns
-    for (int col = 0; col < 3; ++col) {
-        if (b[col] == b[col + 3] && b[col + 3] == b[col + 6]) {
-            if (b[col] == COMPUTER) return +10;
-            else if (b[col] == HUMAN) return -10;
-        }
-    }
-    // Diagonals
-    if (b[0] == b[4] && b[4] == b[8]) {
-        if (b[0] == COMPUTER) return +10;
-        else if (b[0] == HUMAN) return -10;
-    }
-    if (b[2] == b[4] && b[4] == b[6]) {
-        if (b[2] == COMPUTER) return +10;
-        else if (b[2] == HUMAN) return -10;
+// Rules and search live in ttt_engine.cpp; the console game is one of its clients.
+ttt_board toBits(const vector<char>& board) {
+    ttt_board bits = 0;
+    for (int i = 0; i < 9; ++i) {
+        if (board[i] == HUMAN) bits = ttt_board_play(bits, i, TTT_SIDE_X);
+        else if (board[i] == COMPUTER) bits = ttt_board_play(bits, i, TTT_SIDE_O);
     }
-    return 0;
+    return bits;
 }
 
-// Minimax algorithm
-int minimax(vector<char>& board, int depth, bool isMax) {
-    int score = evaluate(board);
-    if (score == 10) return score - depth;   // prefer faster wins
-    if (score == -10) return score + depth;  // prefer slower losses
-    if (!isMovesLeft(board)) return 0; // draw
-
-    if (isMax) {
-        int best = numeric_limits<int>::min();
-        for (int i = 0; i < 9; ++i) {
-            if (board[i] == EMPTY) {
-                board[i] = COMPUTER;
-                best = max(best, minimax(board, depth + 1, !isMax));
-                board[i] = EMPTY;
-            }
-        }
-        return best;
-    } else {
-        int best = numeric_limits<int>::max();
-        for (int i = 0; i < 9; ++i) {
-            if (board[i] == EMPTY) {
-                board[i] = HUMAN;
-                best = min(best, minimax(board, depth + 1, !isMax));
-                board[i] = EMPTY;
-            }
-        }
-        return best;
+ttt_engine* searchEngine() {
+    // One context for the whole program; it caches every position it searches.
+    static unique_ptr<ttt_engine, void (*)(ttt_engine*)> engine(ttt_engine_create(), ttt_engine_destroy);
+    if (!engine) {
+        cout << "Out of memory for the search engine.\n";
+        exit(1);
     }
+    return engine.get();
 }
 
-int findBestMove(vector<char>& board) {
-    int bestVal = numeric_limits<int>::min();
-    int bestMove = -1;
-    for (int i = 0; i < 9; ++i) {
-        if (board[i] == EMPTY) {
-            board[i] = COMPUTER;
-            int moveVal = minimax(board, 0, false);
-            board[i] = EMPTY;
-            if (moveVal > bestVal) {
-                bestMove = i;
-                bestVal = moveVal;
-            }
-        }
-    }
-    return bestMove;
+int findBestMove(const vector<char>& board) {
+    return ttt_find_best_move(searchEngine(), toBits(board), TTT_SIDE_O);
 }
 
 int checkWin(const vector<char>& b) {
-    int val = evaluate(b);
-    if (val == 10) return 1;   // computer
-    if (val == -10) return -1; // human
-    if (!isMovesLeft(b)) return 0; // draw
-    return 2; // game ongoing
+    // 1 computer, -1 human, 0 draw, 2 game ongoing
+    return ttt_check_win(toBits(b));
 }
 
 int promptMove(const vector<char>& board) {
@@ -135,8 +103,400 @@ int promptMove(const vector<char>& board) {
     }
 }
 
-void twoPlayerGame() {
+// ---------- Game records ----------
+// Text form, one block per game, games separated by a blank line:
+//   [Mode "vs-computer"]      two-player or vs-computer
+//   [First "O"]               mark that moved first
+//   [Result "X"]              X, O, D (draw) or * (unfinished)
+//   5 1 9 3 7                 cells 1-9 in move order
+// Binary form: the 8-byte magic "TTTREC1\n" followed by fixed 8-byte records:
+//   byte 0     bits 0-3 move count, bits 4-5 result, bits 6-7 mode
+//   bytes 1-5  cells 0-8, two moves per byte, low nibble first
+//   bytes 6-7  reserved (zero)
+
+enum RecordMode { MODE_TWO_PLAYER = 0, MODE_HUMAN_FIRST = 1, MODE_COMPUTER_FIRST = 2 };
+
+const char BINARY_MAGIC[8] = {'T', 'T', 'T', 'R', 'E', 'C', '1', '\n'};
+const size_t BINARY_RECORD_SIZE = 8;
+const char RESULT_CHARS[4] = {'*', HUMAN, COMPUTER, 'D'};
+
+struct GameRecord {
+    int mode = MODE_TWO_PLAYER;
+    char result = '*';
+    int moveCount = 0;
+    int moves[9] = {};
+
+    char firstMark() const { return mode == MODE_COMPUTER_FIRST ? COMPUTER : HUMAN; }
+};
+
+// One position of a recorded game: the board before `move` was played.
+struct Position {
+    uint16_t x;     // bit i set: X in cell i
+    uint16_t o;     // bit i set: O in cell i
+    char toMove;
+    int8_t move;
+    char result;    // final result of the game
+};
+
+char resultFromState(int state) {
+    if (state == 1) return COMPUTER;
+    if (state == -1) return HUMAN;
+    if (state == 0) return 'D';
+    return '*';
+}
+
+int resultCode(char result) {
+    for (int i = 0; i < 4; ++i) if (RESULT_CHARS[i] == result) return i;
+    return 0;
+}
+
+class RecordWriter {
+public:
+    RecordWriter(const string& path, bool binary) : binary(binary) {
+        file = fopen(path.c_str(), binary ? "ab" : "a");
+        if (file && binary) {
+            fseek(file, 0, SEEK_END);
+            if (ftell(file) == 0) fwrite(BINARY_MAGIC, 1, sizeof(BINARY_MAGIC), file);
+        }
+    }
+    ~RecordWriter() { if (file) fclose(file); }
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    bool ok() const { return file != nullptr; }
+
+    void write(const GameRecord& rec) {
+        if (!file) return;
+        if (binary) {
+            unsigned char out[BINARY_RECORD_SIZE] = {};
+            out[0] = (unsigned char)(rec.moveCount | (resultCode(rec.result) << 4) | (rec.mode << 6));
+            for (int i = 0; i < rec.moveCount; ++i) {
+                out[1 + i / 2] |= (unsigned char)(rec.moves[i] << ((i % 2) * 4));
+            }
+            fwrite(out, 1, sizeof(out), file);
+        } else {
+            fprintf(file, "[Mode \"%s\"]\n[First \"%c\"]\n[Result \"%c\"]\n",
+                    rec.mode == MODE_TWO_PLAYER ? "two-player" : "vs-computer", rec.firstMark(), rec.result);
+            for (int i = 0; i < rec.moveCount; ++i) {
+                fprintf(file, i ? " %d" : "%d", rec.moves[i] + 1);
+            }
+            fputs("\n\n", file);
+        }
+        fflush(file);
+    }
+
+private:
+    FILE* file;
+    bool binary;
+};
+
+// Read-only view of a whole record file: mmap on POSIX, a plain read elsewhere.
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            len = (size_t)st.st_size;
+            if (len == 0) {
+                valid = true;
+            } else {
+                void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    madvise(p, len, MADV_SEQUENTIAL);
+                    map = p;
+                    valid = true;
+                }
+            }
+        }
+        close(fd);
+#else
+        ifstream in(path, ios::binary);
+        if (!in) return;
+        buf.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        len = buf.size();
+        valid = true;
+#endif
+    }
+    ~MappedFile() {
+#ifndef _WIN32
+        if (map) munmap(map, len);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return valid; }
+    size_t size() const { return len; }
+    const char* data() const {
+#ifndef _WIN32
+        return static_cast<const char*>(map);
+#else
+        return buf.data();
+#endif
+    }
+
+private:
+    size_t len = 0;
+    bool valid = false;
+#ifndef _WIN32
+    void* map = nullptr;
+#else
+    vector<char> buf;
+#endif
+};
+
+// Replays the moves with the engine's rules: each must be a free cell 0-8,
+// none may follow a won or drawn position, and a decided result must be the
+// one the final board shows. Anything else marks the record malformed.
+bool validMoves(const GameRecord& rec) {
+    ttt_board board = 0;
+    int side = rec.firstMark() == HUMAN ? TTT_SIDE_X : TTT_SIDE_O;
+    int state = TTT_ONGOING;
+    for (int i = 0; i < rec.moveCount; ++i) {
+        if (state != TTT_ONGOING || rec.moves[i] < 0 || rec.moves[i] > 8) return false;
+        ttt_board next = ttt_board_play(board, rec.moves[i], side);
+        if (next == board) return false; // cell already taken
+        board = next;
+        side = (side == TTT_SIDE_X) ? TTT_SIDE_O : TTT_SIDE_X;
+        state = ttt_check_win(board);
+    }
+    return rec.result == '*' || rec.result == resultFromState(state);
+}
+
+// Parses text records in place; calls onGame for each well-formed game and
+// returns the number of malformed ones that were skipped.
+template <typename OnGame>
+size_t parseTextRecords(const char* p, const char* end, OnGame&& onGame) {
+    size_t bad = 0;
+    GameRecord rec;
+    bool inGame = false, malformed = false, vsComputer = false;
+    char first = HUMAN;
+
+    auto finishGame = [&]() {
+        if (!inGame) return;
+        if (vsComputer) rec.mode = (first == COMPUTER) ? MODE_COMPUTER_FIRST : MODE_HUMAN_FIRST;
+        if (malformed || !validMoves(rec)) ++bad;
+        else onGame(rec);
+        rec = GameRecord();
+        inGame = malformed = vsComputer = false;
+        first = HUMAN;
+    };
+
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+        const char* lineEnd = nl ? nl : end;
+        const char* next = nl ? nl + 1 : end;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+
+        if (lineEnd == p) {
+            finishGame();
+        } else if (*p == '[') {
+            inGame = true;
+            // [Name "Value"]
+            const char* nameEnd = static_cast<const char*>(memchr(p, ' ', (size_t)(lineEnd - p)));
+            const char* q1 = nameEnd ? static_cast<const char*>(memchr(nameEnd, '"', (size_t)(lineEnd - nameEnd))) : nullptr;
+            const char* q2 = q1 ? static_cast<const char*>(memchr(q1 + 1, '"', (size_t)(lineEnd - q1 - 1))) : nullptr;
+            if (!q2) {
+                malformed = true;
+            } else {
+                string_view name(p + 1, (size_t)(nameEnd - p - 1));
+                string_view value(q1 + 1, (size_t)(q2 - q1 - 1));
+                if (name == "Mode") {
+                    vsComputer = (value == "vs-computer");
+                } else if (name == "First") {
+                    if (value.size() != 1 || (value[0] != HUMAN && value[0] != COMPUTER)) malformed = true;
+                    else first = value[0];
+                } else if (name == "Result") {
+                    if (value.size() != 1 || !memchr(RESULT_CHARS, value[0], sizeof(RESULT_CHARS))) malformed = true;
+                    else rec.result = value[0];
+                }
+            }
+        } else {
+            inGame = true;
+            // Moves are single cells 1-9 separated by spaces; "59" or "5x" is not a move.
+            for (const char* c = p; c < lineEnd; ++c) {
+                if (*c == ' ') continue;
+                bool separated = (c + 1 == lineEnd || c[1] == ' ');
+                if (*c < '1' || *c > '9' || !separated || rec.moveCount == 9) { malformed = true; break; }
+                rec.moves[rec.moveCount++] = *c - '1';
+            }
+        }
+        p = next;
+    }
+    finishGame();
+    return bad;
+}
+
+template <typename OnGame>
+size_t parseBinaryRecords(const char* p, const char* end, OnGame&& onGame) {
+    size_t bad = 0;
+    for (; end - p >= (ptrdiff_t)BINARY_RECORD_SIZE; p += BINARY_RECORD_SIZE) {
+        const unsigned char* r = reinterpret_cast<const unsigned char*>(p);
+        GameRecord rec;
+        rec.moveCount = r[0] & 0x0F;
+        rec.result = RESULT_CHARS[(r[0] >> 4) & 0x03];
+        rec.mode = r[0] >> 6;
+        if (rec.moveCount > 9 || rec.mode > MODE_COMPUTER_FIRST) { ++bad; continue; }
+        for (int i = 0; i < rec.moveCount; ++i) rec.moves[i] = (r[1 + i / 2] >> ((i % 2) * 4)) & 0x0F;
+        if (!validMoves(rec)) { ++bad; continue; }
+        onGame(rec);
+    }
+    if (p != end) ++bad; // truncated trailing record
+    return bad;
+}
+
+// Detects the format from the magic and parses every record in the buffer.
+template <typename OnGame>
+size_t parseRecords(const char* data, size_t len, OnGame&& onGame) {
+    if (len >= sizeof(BINARY_MAGIC) && memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+        return parseBinaryRecords(data + sizeof(BINARY_MAGIC), data + len, onGame);
+    }
+    return parseTextRecords(data, data + len, onGame);
+}
+
+// Replays a record and calls onPosition with the board before each move.
+template <typename OnPosition>
+void forEachPosition(const GameRecord& rec, OnPosition&& onPosition) {
+    Position pos{0, 0, rec.firstMark(), 0, rec.result};
+    for (int i = 0; i < rec.moveCount; ++i) {
+        pos.move = (int8_t)rec.moves[i];
+        onPosition(pos);
+        if (pos.toMove == HUMAN) pos.x |= (uint16_t)(1 << rec.moves[i]);
+        else pos.o |= (uint16_t)(1 << rec.moves[i]);
+        pos.toMove = (pos.toMove == HUMAN) ? COMPUTER : HUMAN;
+    }
+}
+
+// --parse: ingest a record file and report totals; optionally dump every
+// position as a fixed 8-byte row (x mask, o mask, to-move, move, result, pad).
+int analyzeRecords(const string& path, const string& positionsPath) {
+    MappedFile file(path);
+    if (!file.ok()) {
+        cout << "Cannot open record file: " << path << "\n";
+        return 1;
+    }
+    FILE* out = nullptr;
+    if (!positionsPath.empty()) {
+        out = fopen(positionsPath.c_str(), "wb");
+        if (!out) {
+            cout << "Cannot open positions file: " << positionsPath << "\n";
+            return 1;
+        }
+    }
+
+    size_t games = 0, positions = 0;
+    size_t results[4] = {};
+    auto start = chrono::steady_clock::now();
+    size_t bad = parseRecords(file.data(), file.size(), [&](const GameRecord& rec) {
+        ++games;
+        ++results[resultCode(rec.result)];
+        forEachPosition(rec, [&](const Position& pos) {
+            ++positions;
+            if (out) {
+                unsigned char row[8] = {
+                    (unsigned char)(pos.x & 0xFF), (unsigned char)(pos.x >> 8),
+                    (unsigned char)(pos.o & 0xFF), (unsigned char)(pos.o >> 8),
+                    (unsigned char)pos.toMove, (unsigned char)pos.move, (unsigned char)pos.result, 0};
+                fwrite(row, 1, sizeof(row), out);
+            }
+        });
+    });
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (out) fclose(out);
+
+    lineStyle();
+    cout << " Games: " << games << "   Positions: " << positions << "   Malformed: " << bad << "\n";
+    cout << " X wins: " << results[1] << "   O wins: " << results[2]
+         << "   Draws: " << results[3] << "   Unfinished: " << results[0] << "\n";
+    cout << " Parsed " << file.size() << " bytes in " << secs * 1000.0 << " ms";
+    if (secs > 0) cout << " (" << (file.size() / secs) / (1024.0 * 1024.0) << " MB/s)";
+    cout << "\n";
+    lineStyle();
+    return 0;
+}
+
+// ---------- Scripted mode ----------
+// --script reads one game per line from stdin and prints one result line per
+// game instead of rendering boards:
+//   p 5 1 9 3 7     two players, X moves first
+//   c 5 1 9         vs computer, human (X) first; only X's moves are listed
+//   C 1 9           vs computer, computer (O) first
+// Blank lines and lines starting with '#' are skipped. Output lines are
+// "<line> <result> <cells played>", where result is X, O, D (draw),
+// * (script ran out of moves) or E (illegal move or mode).
+
+// Plays one script line; returns the result character.
+char playScriptLine(const char* p, const char* end, vector<char>& board, GameRecord& rec) {
+    board.assign(9, EMPTY);
+    rec = GameRecord();
+    char mode = *p++;
+    if (mode != 'p' && mode != 'c' && mode != 'C') return 'E';
+    rec.mode = (mode == 'p') ? MODE_TWO_PLAYER : (mode == 'c') ? MODE_HUMAN_FIRST : MODE_COMPUTER_FIRST;
+    char turn = rec.firstMark();
+
+    while (true) {
+        int state = checkWin(board);
+        if (state != 2) return rec.result = resultFromState(state);
+
+        int move;
+        if (mode != 'p' && turn == COMPUTER) {
+            move = findBestMove(board);
+        } else {
+            while (p < end && *p == ' ') ++p;
+            if (p == end) return '*';
+            if (*p < '1' || *p > '9' || board[*p - '1'] != EMPTY) return 'E';
+            move = *p++ - '1';
+        }
+        board[move] = turn;
+        rec.moves[rec.moveCount++] = move;
+        turn = (turn == HUMAN) ? COMPUTER : HUMAN;
+    }
+}
+
+int scriptedGames(RecordWriter* recorder) {
+    // Slurp stdin in one go; scripts are small compared to the games they drive.
+    string input;
+    char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), stdin)) > 0) input.append(chunk, n);
+
+    string output;
+    vector<char> board;
+    GameRecord rec;
+    const char* p = input.data();
+    const char* end = p + input.size();
+    for (int lineNo = 1; p < end; ++lineNo) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+        const char* lineEnd = nl ? nl : end;
+        const char* next = nl ? nl + 1 : end;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+        while (p < lineEnd && *p == ' ') ++p;
+
+        if (p < lineEnd && *p != '#') {
+            char result = playScriptLine(p, lineEnd, board, rec);
+            if (recorder && result != 'E') {
+                rec.result = result;
+                recorder->write(rec);
+            }
+            output += to_string(lineNo);
+            output += ' ';
+            output += result;
+            output += ' ';
+            for (int i = 0; i < rec.moveCount; ++i) output += (char)('1' + rec.moves[i]);
+            output += '\n';
+        }
+        p = next;
+    }
+    fwrite(output.data(), 1, output.size(), stdout);
+    return 0;
+}
+
+void twoPlayerGame(RecordWriter* recorder = nullptr) {
     vector<char> board(9, EMPTY);
+    GameRecord rec;
     char turn = HUMAN; // X starts
     lineStyle();
     cout << " Two-player mode. X = Player1, O = Player2\n";
@@ -151,8 +511,13 @@ void twoPlayerGame() {
 
         int move = promptMove(board);
         board[move] = turn;
+        rec.moves[rec.moveCount++] = move;
         printBoard(board);
         int state = checkWin(board);
+        if (state != 2) {
+            rec.result = resultFromState(state);
+            if (recorder) recorder->write(rec);
+        }
 
         if (state == 1) { lineStyle(); cout << " O (Player 2) wins!\n"; lineStyle(); break; }
         else if (state == -1) { lineStyle(); cout << " X (Player 1) wins!\n"; lineStyle(); break; }
@@ -162,8 +527,9 @@ void twoPlayerGame() {
     }
 }
 
-void humanVsComputer() {
+void humanVsComputer(RecordWriter* recorder = nullptr) {
     vector<char> board(9, EMPTY);
+    GameRecord rec;
     lineStyle();
     cout << " Human vs Computer\n You are X. Computer is O.\n";
     lineStyle();
@@ -173,6 +539,7 @@ void humanVsComputer() {
     cout << "Do you want to go first? (y/n): ";
     cin >> choice;
     bool humanTurn = (choice == 'y' || choice == 'Y');
+    rec.mode = humanTurn ? MODE_HUMAN_FIRST : MODE_COMPUTER_FIRST;
 
     while (true) {
         if (humanTurn) {
@@ -181,6 +548,7 @@ void humanVsComputer() {
             lineStyle();
             int move = promptMove(board);
             board[move] = HUMAN;
+            rec.moves[rec.moveCount++] = move;
         } else {
             lineStyle();
             cout << " Computer is thinking...\n";
@@ -190,11 +558,16 @@ void humanVsComputer() {
                 for (int i=0;i<9;++i) if (board[i]==EMPTY) { best = i; break; }
             }
             board[best] = COMPUTER;
+            rec.moves[rec.moveCount++] = best;
             cout << " Computer chose position " << (best + 1) << ".\n";
         }
 
         printBoard(board);
         int state = checkWin(board);
+        if (state != 2) {
+            rec.result = resultFromState(state);
+            if (recorder) recorder->write(rec);
+        }
         if (state == 1) { lineStyle(); cout << " Computer (O) wins!\n"; lineStyle(); break; }
         else if (state == -1) { lineStyle(); cout << " You (X) win! Congrats!\n"; lineStyle(); break; }
         else if (state == 0) { lineStyle(); cout << " It's a draw!\n"; lineStyle(); break; }
@@ -203,18 +576,754 @@ void humanVsComputer() {
     }
 }
 
-int main() {
+// ---------- Quantum Tic-Tac-Toe ----------
+// Every move places two "spooky" marks carrying the move number as subscript,
+// entangling two cells. When a move closes a cycle in this entanglement graph
+// the other player chooses which of its two cells the closing mark collapses
+// into; every mark in that component then becomes classical. Cycles are found
+// with an incremental union-find over the 9 cells. A collapsed component never
+// gains new edges, so the union-find never has to be split. If one collapse
+// completes lines for both players, the line whose highest subscript is lower
+// wins.
+
+struct QuantumState {
+    uint8_t classical[9] = {};               // subscript of the classical mark, 0 = none
+    uint8_t edgeA[10] = {}, edgeB[10] = {};  // cells joined by move m's spooky marks
+    uint16_t spooky = 0;                     // bit m: move m is still spooky
+    uint8_t parent[9];                       // union-find over cells
+    uint8_t nextMove = 1;                    // subscript of the next move
+    uint8_t pendingCycle = 0;                // move that closed a cycle, awaiting collapse
+    char firstMark = HUMAN;                  // mark of the odd-numbered moves
+
+    QuantumState() { for (int i = 0; i < 9; ++i) parent[i] = (uint8_t)i; }
+
+    char owner(int m) const {
+        if (m % 2 == 1) return firstMark;
+        return firstMark == HUMAN ? COMPUTER : HUMAN;
+    }
+    // Also the player who resolves a pending collapse.
+    char toMove() const { return owner(nextMove); }
+
+    int find(int c) {
+        while (parent[c] != c) {
+            parent[c] = parent[parent[c]];
+            c = parent[c];
+        }
+        return c;
+    }
+};
+
+enum QuantumMoveKind : int8_t { Q_SPOOKY, Q_COLLAPSE, Q_CLASSICAL };
+
+struct QuantumMove {
+    QuantumMoveKind kind;
+    int8_t a, b;  // Q_SPOOKY: the two cells; otherwise a is the target cell
+};
+
+// Legal moves into `out` (room for 36); returns how many.
+int quantumMoves(const QuantumState& s, QuantumMove* out) {
+    if (s.pendingCycle) {
+        out[0] = {Q_COLLAPSE, (int8_t)s.edgeA[s.pendingCycle], -1};
+        out[1] = {Q_COLLAPSE, (int8_t)s.edgeB[s.pendingCycle], -1};
+        return 2;
+    }
+    int free[9], nFree = 0;
+    for (int i = 0; i < 9; ++i) if (!s.classical[i]) free[nFree++] = i;
+    if (nFree == 1) {
+        // A lone cell cannot hold a spooky pair; the last mark goes there directly.
+        out[0] = {Q_CLASSICAL, (int8_t)free[0], -1};
+        return 1;
+    }
+    int n = 0;
+    for (int i = 0; i < nFree; ++i)
+        for (int j = i + 1; j < nFree; ++j) out[n++] = {Q_SPOOKY, (int8_t)free[i], (int8_t)free[j]};
+    return n;
+}
+
+// Resolves the pending cycle with its closing mark placed in `cell`. Each mark
+// that becomes classical forces the other marks sharing its cell to their
+// other end, which collapses the whole component.
+void collapseQuantum(QuantumState& s, int cell) {
+    int stackMove[10], stackCell[10], top = 0;
+    stackMove[top] = s.pendingCycle;
+    stackCell[top++] = cell;
+    while (top > 0) {
+        --top;
+        int m = stackMove[top], c = stackCell[top];
+        if (!(s.spooky & (1 << m))) continue;
+        s.spooky &= (uint16_t)~(1 << m);
+        s.classical[c] = (uint8_t)m;
+        for (int k = 1; k < 10; ++k) {
+            if (!(s.spooky & (1 << k)) || (s.edgeA[k] != c && s.edgeB[k] != c)) continue;
+            stackMove[top] = k;
+            stackCell[top++] = (s.edgeA[k] == c) ? s.edgeB[k] : s.edgeA[k];
+        }
+    }
+    s.pendingCycle = 0;
+}
+
+void applyQuantumMove(QuantumState& s, QuantumMove mv) {
+    if (mv.kind == Q_COLLAPSE) {
+        collapseQuantum(s, mv.a);
+    } else if (mv.kind == Q_CLASSICAL) {
+        s.classical[mv.a] = s.nextMove++;
+    } else {
+        int m = s.nextMove++;
+        s.edgeA[m] = (uint8_t)mv.a;
+        s.edgeB[m] = (uint8_t)mv.b;
+        s.spooky |= (uint16_t)(1 << m);
+        int ra = s.find(mv.a), rb = s.find(mv.b);
+        if (ra == rb) s.pendingCycle = (uint8_t)m;
+        else s.parent[ra] = (uint8_t)rb;
+    }
+}
+
+const int LINE_CELLS[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8}, {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, {0, 4, 8}, {2, 4, 6}};
+
+// HUMAN or COMPUTER for a win, 'D' for a draw, '*' while the game goes on.
+char quantumWinner(const QuantumState& s) {
+    int best[2] = {100, 100}; // lowest "highest subscript" of a line, per mark
+    for (const auto& line : LINE_CELLS) {
+        int m0 = s.classical[line[0]], m1 = s.classical[line[1]], m2 = s.classical[line[2]];
+        if (!m0 || !m1 || !m2) continue;
+        char o = s.owner(m0);
+        if (s.owner(m1) != o || s.owner(m2) != o) continue;
+        int& b = best[o == COMPUTER];
+        b = min(b, max(m0, max(m1, m2)));
+    }
+    if (best[0] < best[1]) return HUMAN;
+    if (best[1] < best[0]) return COMPUTER;
+    if (s.pendingCycle) return '*';
+    for (int i = 0; i < 9; ++i) if (!s.classical[i]) return '*';
+    return 'D';
+}
+
+// Alpha-beta search with a transposition table keyed by a Zobrist hash that is
+// canonical under the 8 symmetries of the board, so rotated and reflected
+// positions share entries.
+class QuantumAI {
+public:
+    explicit QuantumAI(int depth = 5) : depth(depth), table(1 << 18) {
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        auto next = [&seed]() {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+        for (auto& row : classicalKey) for (auto& k : row) k = next();
+        for (auto& row : edgeKey) for (auto& k : row) k = next();
+        for (auto& k : pendingKey) k = next();
+        firstKey = next();
+        for (int t = 0; t < 8; ++t) {
+            for (int i = 0; i < 9; ++i) {
+                int r = i / 3, c = i % 3, tr = r, tc = c;
+                if (t & 1) tc = 2 - tc;          // mirror
+                for (int k = 0; k < (t >> 1); ++k) { // rotate 90 degrees k times
+                    int nr = tc, nc = 2 - tr;
+                    tr = nr;
+                    tc = nc;
+                }
+                sym[t][i] = (uint8_t)(tr * 3 + tc);
+            }
+        }
+    }
+
+    QuantumMove choose(const QuantumState& s) {
+        nodes = 0;
+        QuantumMove moves[36];
+        int n = quantumMoves(s, moves);
+        bool isMax = (s.toMove() == COMPUTER);
+        QuantumMove best = moves[0];
+        int bestVal = isMax ? -INF : INF;
+        for (int i = 0; i < n; ++i) {
+            QuantumState child = s;
+            applyQuantumMove(child, moves[i]);
+            int v = search(child, depth - 1, 1, -INF, INF);
+            if (isMax ? v > bestVal : v < bestVal) {
+                bestVal = v;
+                best = moves[i];
+            }
+        }
+        return best;
+    }
+
+    long long lastNodes() const { return nodes; }
+
+private:
+    static const int INF = 1000000;
+    static const int WIN = 10000;
+    enum Bound : uint8_t { EXACT, LOWER, UPPER };
+    struct Entry {
+        uint64_t key = 0;
+        int32_t score = 0;
+        int8_t depth = -1;
+        Bound bound = EXACT;
+    };
+
+    int depth;
+    vector<Entry> table;
+    uint64_t classicalKey[9][10];
+    uint64_t edgeKey[10][81];
+    uint64_t pendingKey[10];
+    uint64_t firstKey;
+    uint8_t sym[8][9];
+    long long nodes = 0;
+
+    uint64_t canonicalKey(const QuantumState& s) const {
+        uint64_t base = pendingKey[s.pendingCycle] ^ (s.firstMark == COMPUTER ? firstKey : 0);
+        uint64_t best = ~0ULL;
+        for (int t = 0; t < 8; ++t) {
+            uint64_t h = base;
+            for (int i = 0; i < 9; ++i) if (s.classical[i]) h ^= classicalKey[sym[t][i]][s.classical[i]];
+            for (int m = 1; m < 10; ++m) {
+                if (!(s.spooky & (1 << m))) continue;
+                int a = sym[t][s.edgeA[m]], b = sym[t][s.edgeB[m]];
+                h ^= edgeKey[m][min(a, b) * 9 + max(a, b)];
+            }
+            best = min(best, h);
+        }
+        return best;
+    }
+
+    // Lines still open to one mark: classical marks count 9, spooky marks 1.
+    int heuristic(const QuantumState& s) const {
+        int weight[9] = {};
+        char mark[9] = {};
+        for (int i = 0; i < 9; ++i) {
+            if (s.classical[i]) {
+                weight[i] = 9;
+                mark[i] = s.owner(s.classical[i]);
+            }
+        }
+        int score = 0;
+        for (const auto& line : LINE_CELLS) {
+            int comp = 0, human = 0;
+            for (int c : line) {
+                if (mark[c] == COMPUTER) comp += weight[c];
+                else if (mark[c] == HUMAN) human += weight[c];
+            }
+            for (int m = 1; m < 10; ++m) {
+                if (!(s.spooky & (1 << m))) continue;
+                for (int c : line) {
+                    if (c != s.edgeA[m] && c != s.edgeB[m]) continue;
+                    if (s.owner(m) == COMPUTER) ++comp;
+                    else ++human;
+                }
+            }
+            if (human == 0) score += comp * comp;
+            if (comp == 0) score -= human * human;
+        }
+        return score;
+    }
+
+    // Score from the computer's point of view; wins found sooner score higher.
+    int search(const QuantumState& s, int d, int ply, int alpha, int beta) {
+        ++nodes;
+        char w = quantumWinner(s);
+        if (w == COMPUTER) return WIN - ply;
+        if (w == HUMAN) return -WIN + ply;
+        if (w == 'D') return 0;
+        if (d <= 0) return heuristic(s);
+
+        uint64_t key = canonicalKey(s);
+        Entry& e = table[key & (table.size() - 1)];
+        if (e.key == key && e.depth >= d) {
+            int v = fromTable(e.score, ply);
+            if (e.bound == EXACT) return v;
+            if (e.bound == LOWER) alpha = max(alpha, v);
+            else beta = min(beta, v);
+            if (alpha >= beta) return v;
+        }
+
+        int alphaIn = alpha, betaIn = beta;
+        QuantumMove moves[36];
+        int n = quantumMoves(s, moves);
+        bool isMax = (s.toMove() == COMPUTER);
+        int best = isMax ? -INF : INF;
+        for (int i = 0; i < n && alpha < beta; ++i) {
+            QuantumState child = s;
+            applyQuantumMove(child, moves[i]);
+            int v = search(child, d - 1, ply + 1, alpha, beta);
+            if (isMax) {
+                best = max(best, v);
+                alpha = max(alpha, v);
+            } else {
+                best = min(best, v);
+                beta = min(beta, v);
+            }
+        }
+
+        e.key = key;
+        e.depth = (int8_t)d;
+        e.score = toTable(best, ply);
+        e.bound = (best <= alphaIn) ? UPPER : (best >= betaIn) ? LOWER : EXACT;
+        return best;
+    }
+
+    // Win scores are stored relative to the node so they stay valid at any ply.
+    static int toTable(int v, int ply) { return v > WIN / 2 ? v + ply : v < -WIN / 2 ? v - ply : v; }
+    static int fromTable(int v, int ply) { return v > WIN / 2 ? v - ply : v < -WIN / 2 ? v + ply : v; }
+};
+
+void printQuantumBoard(const QuantumState& s) {
+    cout << "\n";
+    lineStyle();
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            int i = r * 3 + c;
+            if (s.classical[i]) cout << " " << s.owner(s.classical[i]) << (int)s.classical[i];
+            else cout << " " << (i + 1) << " ";
+            if (c < 2) cout << "|";
+        }
+        cout << "\n";
+        if (r < 2) cout << "---+---+---\n";
+    }
+    if (s.spooky) {
+        cout << "Spooky marks:";
+        for (int m = 1; m < 10; ++m) {
+            if (s.spooky & (1 << m)) {
+                cout << " " << s.owner(m) << m << "(" << s.edgeA[m] + 1 << "," << s.edgeB[m] + 1 << ")";
+            }
+        }
+        cout << "\n";
+    }
+    lineStyle();
+    cout << "\n";
+}
+
+// Reads a free cell (1-9) with the same recovery as promptMove().
+int promptQuantumCell(const QuantumState& s, const string& prompt) {
+    while (true) {
+        cout << prompt;
+        int pos;
+        if (!(cin >> pos)) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid input. Please enter a number 1-9.\n";
+            continue;
+        }
+        if (pos < 1 || pos > 9) {
+            cout << "Position must be 1..9.\n";
+            continue;
+        }
+        if (s.classical[pos - 1]) {
+            cout << "Cell already collapsed. Choose another.\n";
+            continue;
+        }
+        return pos - 1;
+    }
+}
+
+QuantumMove promptQuantumMove(const QuantumState& s) {
+    QuantumMove moves[36];
+    int n = quantumMoves(s, moves);
+    if (moves[0].kind == Q_CLASSICAL) {
+        cout << " Only cell " << moves[0].a + 1 << " is left; your mark goes there.\n";
+        return moves[0];
+    }
+    if (moves[0].kind == Q_COLLAPSE) {
+        int m = s.pendingCycle;
+        cout << " " << s.owner(m) << m << " closed a cycle.\n";
+        while (true) {
+            int cell = promptQuantumCell(s, "Collapse it into cell " + to_string(s.edgeA[m] + 1) +
+                                                " or " + to_string(s.edgeB[m] + 1) + ": ");
+            for (int i = 0; i < n; ++i) if (moves[i].a == cell) return moves[i];
+            cout << "Choose one of the two entangled cells.\n";
+        }
+    }
+    while (true) {
+        int a = promptQuantumCell(s, "First cell of your spooky mark (1-9): ");
+        int b = promptQuantumCell(s, "Second cell of your spooky mark (1-9): ");
+        if (a != b) return {Q_SPOOKY, (int8_t)min(a, b), (int8_t)max(a, b)};
+        cout << "The two cells must differ.\n";
+    }
+}
+
+void quantumGame() {
+    QuantumState s;
+    QuantumAI ai;
+    lineStyle();
+    cout << " Quantum Tic-Tac-Toe\n Each move marks two cells; cycles collapse.\n";
+    lineStyle();
+
+    char choice;
+    cout << "Play against the computer? (y/n): ";
+    cin >> choice;
+    bool vsComputer = (choice == 'y' || choice == 'Y');
+    if (vsComputer) {
+        cout << "Do you want to go first? (y/n): ";
+        cin >> choice;
+        if (choice != 'y' && choice != 'Y') s.firstMark = COMPUTER;
+    }
+
+    while (true) {
+        printQuantumBoard(s);
+        char w = quantumWinner(s);
+        if (w == 'D') { lineStyle(); cout << " It's a draw!\n"; lineStyle(); break; }
+        if (w != '*') { lineStyle(); cout << " " << w << " wins!\n"; lineStyle(); break; }
+
+        char side = s.toMove();
+        QuantumMove mv;
+        if (vsComputer && side == COMPUTER) {
+            lineStyle();
+            cout << " Computer is thinking...\n";
+            lineStyle();
+            mv = ai.choose(s);
+            if (mv.kind == Q_SPOOKY) cout << " Computer entangled cells " << mv.a + 1 << " and " << mv.b + 1 << ".\n";
+            else cout << " Computer collapsed " << side << " into cell " << mv.a + 1 << ".\n";
+        } else {
+            lineStyle();
+            cout << " Player " << side << "'s turn (move " << (int)s.nextMove << ").\n";
+            lineStyle();
+            mv = promptQuantumMove(s);
+        }
+        applyQuantumMove(s, mv);
+    }
+}
+
+// ---------- Multi-player k-in-a-row ----------
+// 2-4 players on boards up to 8x8; the first to get k marks in a row wins.
+// Every player's marks are a 64-bit bitboard, and each k-cell line segment
+// ("window") is a precomputed mask, so a win test is a few AND/compares.
+// The computer plays with either paranoid search (everyone else is assumed
+// to play against it; plain alpha-beta) or max-n (each player maximizes its
+// own share of a constant-sum score) with shallow pruning.
+
+const char PLAYER_MARKS[4] = {HUMAN, COMPUTER, '#', '@'};
+const int MAX_PLAYERS = 4;
+
+struct MultiRules {
+    int size;
+    int k;
+    int players;
+    vector<uint64_t> windows;               // every k-in-a-row segment
+    vector<vector<uint64_t>> cellWindows;   // windows through each cell
+    vector<int> order;                      // cells, centre first
+    uint64_t full;
+
+    MultiRules(int size, int k, int players) : size(size), k(k), players(players), cellWindows(size * size) {
+        const int dr[4] = {0, 1, 1, 1}, dc[4] = {1, 0, 1, -1};
+        for (int r = 0; r < size; ++r) {
+            for (int c = 0; c < size; ++c) {
+                for (int d = 0; d < 4; ++d) {
+                    int er = r + dr[d] * (k - 1), ec = c + dc[d] * (k - 1);
+                    if (er < 0 || er >= size || ec < 0 || ec >= size) continue;
+                    uint64_t w = 0;
+                    for (int i = 0; i < k; ++i) w |= 1ULL << ((r + dr[d] * i) * size + (c + dc[d] * i));
+                    windows.push_back(w);
+                    for (int i = 0; i < k; ++i) cellWindows[(r + dr[d] * i) * size + (c + dc[d] * i)].push_back(w);
+                }
+            }
+        }
+        int cells = size * size;
+        full = (cells == 64) ? ~0ULL : ((1ULL << cells) - 1);
+        for (int i = 0; i < cells; ++i) order.push_back(i);
+        double mid = (size - 1) / 2.0;
+        auto dist = [&](int i) { return abs(i / size - mid) + abs(i % size - mid); };
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return dist(a) < dist(b); });
+    }
+
+    bool wins(uint64_t mine, int cell) const {
+        for (uint64_t w : cellWindows[cell]) if ((mine & w) == w) return true;
+        return false;
+    }
+};
+
+struct MultiState {
+    uint64_t bits[MAX_PLAYERS] = {};
+    int toMove = 0;
+
+    uint64_t occupied() const { return bits[0] | bits[1] | bits[2] | bits[3]; }
+};
+
+class MultiAI {
+public:
+    enum Algorithm { PARANOID, MAXN };
+
+    MultiAI(const MultiRules& rules, Algorithm algo, int depth) : rules(rules), algo(algo), depth(depth) {}
+
+    int chooseMove(MultiState s) {
+        nodes = 0;
+        int me = s.toMove, bestCell = -1;
+        int bestVal = numeric_limits<int>::min();
+        uint64_t occ = s.occupied();
+        for (int cell : rules.order) {
+            uint64_t bit = 1ULL << cell;
+            if (occ & bit) continue;
+            s.bits[me] |= bit;
+            int v;
+            if (rules.wins(s.bits[me], cell)) {
+                v = numeric_limits<int>::max();
+            } else {
+                s.toMove = (me + 1) % rules.players;
+                if (algo == PARANOID) {
+                    v = paranoid(s, depth - 1, 1, numeric_limits<int>::min() / 2, numeric_limits<int>::max() / 2, me);
+                } else {
+                    int scores[MAX_PLAYERS];
+                    maxn(s, depth - 1, 1, bestVal == numeric_limits<int>::min() ? -1 : bestVal, scores);
+                    v = scores[me];
+                }
+                s.toMove = me;
+            }
+            s.bits[me] &= ~bit;
+            if (v > bestVal) {
+                bestVal = v;
+                bestCell = cell;
+            }
+            if (v == numeric_limits<int>::max()) break;
+        }
+        return bestCell;
+    }
+
+    long long lastNodes() const { return nodes; }
+
+private:
+    static const int WIN = 1000000;
+    static const int MAXSUM = 1000; // max-n scores of all players add up to this
+
+    const MultiRules& rules;
+    Algorithm algo;
+    int depth;
+    long long nodes = 0;
+
+    // Windows still open to player p, weighted 4^marks.
+    int potential(const MultiState& s, int p) const {
+        uint64_t mine = s.bits[p], others = s.occupied() & ~mine;
+        int score = 0;
+        for (uint64_t w : rules.windows) {
+            if (w & others) continue;
+            score += 1 << (2 * __builtin_popcountll(mine & w));
+        }
+        return score;
+    }
+
+    int paranoid(MultiState& s, int d, int ply, int alpha, int beta, int root) {
+        ++nodes;
+        uint64_t occ = s.occupied();
+        if (occ == rules.full) return 0;
+        if (d == 0) {
+            int worst = 0;
+            for (int p = 0; p < rules.players; ++p) if (p != root) worst = max(worst, potential(s, p));
+            return potential(s, root) - worst;
+        }
+        int p = s.toMove;
+        bool isMax = (p == root);
+        int best = isMax ? numeric_limits<int>::min() : numeric_limits<int>::max();
+        for (int cell : rules.order) {
+            uint64_t bit = 1ULL << cell;
+            if (occ & bit) continue;
+            s.bits[p] |= bit;
+            int v;
+            if (rules.wins(s.bits[p], cell)) {
+                v = isMax ? WIN - ply : -WIN + ply;
+            } else {
+                s.toMove = (p + 1) % rules.players;
+                v = paranoid(s, d - 1, ply + 1, alpha, beta, root);
+                s.toMove = p;
+            }
+            s.bits[p] &= ~bit;
+            if (isMax) {
+                best = max(best, v);
+                alpha = max(alpha, v);
+            } else {
+                best = min(best, v);
+                beta = min(beta, v);
+            }
+            if (alpha >= beta) break;
+        }
+        return best;
+    }
+
+    // Fills out[] with every player's score. parentBest is the best score the
+    // parent's player has found so far (-1 for none): once the player to move
+    // here can claim MAXSUM - parentBest, the parent will never pick this node.
+    void maxn(MultiState& s, int d, int ply, int parentBest, int* out) {
+        ++nodes;
+        uint64_t occ = s.occupied();
+        int n = rules.players;
+        if (occ == rules.full) {
+            for (int p = 0; p < n; ++p) out[p] = MAXSUM / n;
+            return;
+        }
+        if (d == 0) {
+            int total = 0;
+            for (int p = 0; p < n; ++p) total += (out[p] = potential(s, p));
+            for (int p = 0; p < n; ++p) out[p] = total ? out[p] * MAXSUM / total : MAXSUM / n;
+            return;
+        }
+        int p = s.toMove;
+        int child[MAX_PLAYERS];
+        out[p] = -1;
+        for (int cell : rules.order) {
+            uint64_t bit = 1ULL << cell;
+            if (occ & bit) continue;
+            s.bits[p] |= bit;
+            if (rules.wins(s.bits[p], cell)) {
+                for (int q = 0; q < n; ++q) child[q] = (q == p) ? MAXSUM : 0;
+            } else {
+                s.toMove = (p + 1) % n;
+                maxn(s, d - 1, ply + 1, out[p], child);
+                s.toMove = p;
+            }
+            s.bits[p] &= ~bit;
+            if (child[p] > out[p]) for (int q = 0; q < n; ++q) out[q] = child[q];
+            if (out[p] >= MAXSUM || (parentBest >= 0 && out[p] >= MAXSUM - parentBest)) break;
+        }
+    }
+};
+
+void printMultiBoard(const MultiRules& rules, const MultiState& s) {
+    cout << "\n";
+    lineStyle();
+    for (int r = 0; r < rules.size; ++r) {
+        for (int c = 0; c < rules.size; ++c) {
+            int cell = r * rules.size + c;
+            char mark = 0;
+            for (int p = 0; p < rules.players; ++p) if (s.bits[p] & (1ULL << cell)) mark = PLAYER_MARKS[p];
+            if (mark) cout << "  " << mark;
+            else cout << (cell + 1 < 10 ? "  " : " ") << cell + 1;
+            cout << (c + 1 < rules.size ? " |" : "\n");
+        }
+        if (r + 1 < rules.size) {
+            for (int c = 0; c < rules.size; ++c) cout << (c + 1 < rules.size ? "----+" : "----\n");
+        }
+    }
+    lineStyle();
+    cout << "\n";
+}
+
+// Reads an integer in [lo, hi] with the same recovery as promptMove().
+int promptNumber(const string& prompt, int lo, int hi) {
+    while (true) {
+        cout << prompt;
+        int v;
+        if (!(cin >> v)) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid input. Please enter a number.\n";
+            continue;
+        }
+        if (v < lo || v > hi) {
+            cout << "Please enter a number " << lo << ".." << hi << ".\n";
+            continue;
+        }
+        return v;
+    }
+}
+
+void multiPlayerGame() {
+    lineStyle();
+    cout << " Multi-player k-in-a-row\n";
+    lineStyle();
+    int players = promptNumber("Number of players (2-4): ", 2, MAX_PLAYERS);
+    int size = promptNumber("Board size (3-8): ", 3, 8);
+    int k = promptNumber("Marks in a row to win (3-" + to_string(size) + "): ", 3, size);
+    int humans = promptNumber("How many of them are human (0-" + to_string(players) + ")? ", 0, players);
+    int algo = promptNumber("Computer search: 1) paranoid  2) max-n : ", 1, 2);
+
+    MultiRules rules(size, k, players);
+    MultiAI ai(rules, algo == 1 ? MultiAI::PARANOID : MultiAI::MAXN, algo == 1 ? 5 : 4);
+    MultiState s;
+    printMultiBoard(rules, s);
+
+    while (true) {
+        int p = s.toMove;
+        int cell;
+        lineStyle();
+        if (p < humans) {
+            cout << " Player " << PLAYER_MARKS[p] << "'s turn.\n";
+            lineStyle();
+            while (true) {
+                cell = promptNumber("Enter your move (1-" + to_string(size * size) + "): ", 1, size * size) - 1;
+                if (!(s.occupied() & (1ULL << cell))) break;
+                cout << "Cell already taken. Choose another.\n";
+            }
+        } else {
+            cout << " Computer " << PLAYER_MARKS[p] << " is thinking...\n";
+            lineStyle();
+            cell = ai.chooseMove(s);
+            cout << " Computer " << PLAYER_MARKS[p] << " chose position " << cell + 1 << ".\n";
+        }
+        s.bits[p] |= 1ULL << cell;
+        printMultiBoard(rules, s);
+
+        if (rules.wins(s.bits[p], cell)) { lineStyle(); cout << " " << PLAYER_MARKS[p] << " wins!\n"; lineStyle(); break; }
+        if (s.occupied() == rules.full) { lineStyle(); cout << " It's a draw!\n"; lineStyle(); break; }
+        s.toMove = (p + 1) % players;
+    }
+}
+
+// --bench-multi: node throughput of both searches as the player count grows,
+// on a 6x6 board (4 in a row) from the same opening.
+int benchMultiPlayer() {
+    lineStyle();
+    cout << " players  search     depth        nodes      ms     nodes/s\n";
+    for (int players = 2; players <= MAX_PLAYERS; ++players) {
+        MultiRules rules(6, 4, players);
+        for (int algo = 0; algo < 2; ++algo) {
+            int depth = algo == 0 ? 5 : 4;
+            MultiAI ai(rules, algo == 0 ? MultiAI::PARANOID : MultiAI::MAXN, depth);
+            MultiState s;
+            const int opening[4] = {14, 21, 15, 20};
+            for (int p = 0; p < players; ++p) s.bits[p] |= 1ULL << opening[p];
+            auto start = chrono::steady_clock::now();
+            ai.chooseMove(s);
+            double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            printf(" %7d  %-9s %6d %12lld %7.1f %11.0f\n", players, algo == 0 ? "paranoid" : "max-n",
+                   depth, ai.lastNodes(), secs * 1000.0, secs > 0 ? ai.lastNodes() / secs : 0.0);
+        }
+    }
+    lineStyle();
+    return 0;
+}
+
+void printUsage() {
+    cout << "Usage: tictactoe [--record FILE [--binary]] [--script]\n"
+            "       tictactoe --parse FILE [--positions OUT]\n"
+            "       tictactoe --bench-multi\n";
+}
+
+int main(int argc, char* argv[]) {
+    string recordPath, parsePath, positionsPath;
+    bool binary = false, script = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (arg == "--binary") binary = true;
+        else if (arg == "--script") script = true;
+        else if (arg == "--bench-multi") return benchMultiPlayer();
+        else if (arg == "--parse" && i + 1 < argc) parsePath = argv[++i];
+        else if (arg == "--positions" && i + 1 < argc) positionsPath = argv[++i];
+        else { printUsage(); return 1; }
+    }
+    if (!parsePath.empty()) return analyzeRecords(parsePath, positionsPath);
+
+    unique_ptr<RecordWriter> recorder;
+    if (!recordPath.empty()) {
+        recorder = make_unique<RecordWriter>(recordPath, binary);
+        if (!recorder->ok()) {
+            cout << "Cannot open record file: " << recordPath << "\n";
+            return 1;
+        }
+    }
+
+    if (script) return scriptedGames(recorder.get());
+
     lineStyle();
     cout << "          === Tic-Tac-Toe Game ===\n";
     lineStyle();
-    cout << "1) Two players\n2) Play vs Computer (AI)\nChoose mode (1 or 2): ";
+    cout << "1) Two players\n2) Play vs Computer (AI)\n3) Quantum Tic-Tac-Toe\n4) Multi-player k-in-a-row\nChoose mode (1-4): ";
     int mode;
     if (!(cin >> mode)) {
         cout << "Invalid input. Exiting.\n";
         return 0;
     }
-    if (mode == 1) twoPlayerGame();
-    else if (mode == 2) humanVsComputer();
+    if (mode == 1) twoPlayerGame(recorder.get());
+    else if (mode == 2) humanVsComputer(recorder.get());
+    else if (mode == 3) quantumGame();
+    else if (mode == 4) multiPlayerGame();
     else cout << "Unknown mode. Exiting.\n";
     return 0;
 }
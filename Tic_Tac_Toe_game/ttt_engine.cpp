@@ -0,0 +1,149 @@
+// ttt_engine.cpp
+// Bitboard implementation of the C API declared in ttt_engine.h.
+// Kept free of iostream so the library never touches cout/cin.
+
+#define TTT_ENGINE_BUILD
+#include "ttt_engine.h"
+
+#include <cstring>
+#include <new>
+
+namespace {
+
+const uint32_t CELLS = 0x1FF;
+const int8_t UNKNOWN = 127;
+const int POSITIONS = 19683; // 3^9
+
+// Rows, columns, diagonals.
+const uint32_t LINES[8] = {0x007, 0x038, 0x1C0, 0x049, 0x092, 0x124, 0x111, 0x054};
+
+inline uint32_t xBits(ttt_board b) { return b & CELLS; }
+inline uint32_t oBits(ttt_board b) { return (b >> 9) & CELLS; }
+
+int evaluateBits(ttt_board b) {
+    uint32_t x = xBits(b), o = oBits(b);
+    for (uint32_t line : LINES) {
+        if ((o & line) == line) return +10;
+        if ((x & line) == line) return -10;
+    }
+    return 0;
+}
+
+bool full(ttt_board b) { return (xBits(b) | oBits(b)) == CELLS; }
+
+int positionCode(ttt_board b) {
+    uint32_t x = xBits(b), o = oBits(b);
+    int code = 0;
+    for (int i = 0; i < 9; ++i) code = code * 3 + ((x >> i) & 1) + 2 * ((o >> i) & 1);
+    return code;
+}
+
+// Scores at depth d are the depth-0 score moved d points towards zero,
+// so only depth-0 scores are cached.
+inline int atDepth(int score, int depth) {
+    if (score > 0) return score - depth;
+    if (score < 0) return score + depth;
+    return 0;
+}
+
+} // namespace
+
+struct ttt_engine {
+    int8_t cache[2][POSITIONS]; // [isMax][positionCode]
+};
+
+namespace {
+
+// Minimax value of the board at depth 0, memoized in the engine.
+int search(ttt_engine* e, ttt_board b, bool isMax) {
+    int8_t& slot = e->cache[isMax][positionCode(b)];
+    if (slot != UNKNOWN) return slot;
+
+    int score = evaluateBits(b);
+    if (score == 0 && !full(b)) {
+        uint32_t used = xBits(b) | oBits(b);
+        int best = isMax ? -1000 : 1000;
+        for (int i = 0; i < 9; ++i) {
+            if (used & (1u << i)) continue;
+            ttt_board child = b | (1u << (i + (isMax ? 9 : 0)));
+            int v = atDepth(search(e, child, !isMax), 1);
+            if (isMax ? v > best : v < best) best = v;
+        }
+        score = best;
+    }
+    slot = (int8_t)score;
+    return score;
+}
+
+} // namespace
+
+extern "C" {
+
+unsigned ttt_api_version(void) { return TTT_API_VERSION; }
+
+ttt_engine* ttt_engine_create(void) {
+    ttt_engine* e = new (std::nothrow) ttt_engine;
+    if (e) ttt_engine_clear(e);
+    return e;
+}
+
+void ttt_engine_destroy(ttt_engine* engine) { delete engine; }
+
+void ttt_engine_clear(ttt_engine* engine) {
+    if (engine) memset(engine->cache, UNKNOWN, sizeof(engine->cache));
+}
+
+int ttt_board_valid(ttt_board board) {
+    return (board >> 18) == 0 && (xBits(board) & oBits(board)) == 0;
+}
+
+ttt_board ttt_board_play(ttt_board board, int cell, int side) {
+    if (cell < 0 || cell > 8 || ((xBits(board) | oBits(board)) & (1u << cell))) return board;
+    return board | (1u << (cell + (side == TTT_SIDE_O ? 9 : 0)));
+}
+
+int ttt_board_from_string(const char* cells, ttt_board* out) {
+    if (!cells || !out) return 0;
+    ttt_board b = 0;
+    for (int i = 0; i < 9; ++i) {
+        if (cells[i] == '\0') return 0;
+        if (cells[i] == 'X' || cells[i] == 'x') b |= 1u << i;
+        else if (cells[i] == 'O' || cells[i] == 'o') b |= 1u << (i + 9);
+    }
+    *out = b;
+    return 1;
+}
+
+int ttt_evaluate(ttt_board board) { return evaluateBits(board); }
+
+int ttt_check_win(ttt_board board) {
+    if (!ttt_board_valid(board)) return TTT_INVALID;
+    int val = evaluateBits(board);
+    if (val == 10) return TTT_O_WINS;
+    if (val == -10) return TTT_X_WINS;
+    if (full(board)) return TTT_DRAW;
+    return TTT_ONGOING;
+}
+
+int ttt_minimax(ttt_engine* engine, ttt_board board, int depth, int is_max) {
+    if (!engine || !ttt_board_valid(board)) return 0;
+    return atDepth(search(engine, board, is_max != 0), depth);
+}
+
+int ttt_find_best_move(ttt_engine* engine, ttt_board board, int side) {
+    if (!engine || ttt_check_win(board) != TTT_ONGOING) return -1;
+    bool isO = (side == TTT_SIDE_O);
+    uint32_t used = xBits(board) | oBits(board);
+    int bestMove = -1, bestVal = 0;
+    for (int i = 0; i < 9; ++i) {
+        if (used & (1u << i)) continue;
+        int v = search(engine, board | (1u << (i + (isO ? 9 : 0))), !isO);
+        if (bestMove == -1 || (isO ? v > bestVal : v < bestVal)) {
+            bestMove = i;
+            bestVal = v;
+        }
+    }
+    return bestMove;
+}
+
+} // extern "C"
@@ -0,0 +1,82 @@
+/* ttt_engine.h
+ * Embeddable Tic-Tac-Toe rules and Minimax search with a C ABI.
+ * The console game (tictactoe.cpp) plays through it. O is the maximizing
+ * side: a line for O evaluates to +10 and a line for X to -10.
+ *
+ * Build:  g++ -std=c++17 -O2 -fPIC -shared -fvisibility=hidden ttt_engine.cpp -o libtttengine.so
+ * Define TTT_ENGINE_STATIC when compiling it straight into a program instead,
+ * as tictactoe.cpp does.
+ *
+ * Every search call takes an engine context that owns its position cache.
+ * Contexts are independent, so each thread can use its own without locking;
+ * a single context must not be used by two threads at once. Nothing here
+ * reads from or writes to the console.
+ */
+#ifndef TTT_ENGINE_H
+#define TTT_ENGINE_H
+
+#include <stdint.h>
+
+#if defined(TTT_ENGINE_STATIC)
+  #define TTT_API
+#elif defined(_WIN32)
+  #if defined(TTT_ENGINE_BUILD)
+    #define TTT_API __declspec(dllexport)
+  #else
+    #define TTT_API __declspec(dllimport)
+  #endif
+#else
+  #define TTT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bits 0-8: cells holding X, bits 9-17: cells holding O (cell = row * 3 + col). */
+typedef uint32_t ttt_board;
+
+typedef struct ttt_engine ttt_engine;
+
+#define TTT_API_VERSION 1
+
+#define TTT_SIDE_X 0
+#define TTT_SIDE_O 1
+
+/* ttt_check_win results */
+#define TTT_X_WINS   (-1)
+#define TTT_DRAW       0
+#define TTT_O_WINS     1
+#define TTT_ONGOING    2
+#define TTT_INVALID    3
+
+TTT_API unsigned ttt_api_version(void);
+
+/* Returns NULL if out of memory. */
+TTT_API ttt_engine* ttt_engine_create(void);
+TTT_API void ttt_engine_destroy(ttt_engine* engine);
+/* Drops cached positions (the cache never needs invalidating for correctness). */
+TTT_API void ttt_engine_clear(ttt_engine* engine);
+
+/* 1 if no cell is claimed twice and no bits above 17 are set. */
+TTT_API int ttt_board_valid(ttt_board board);
+TTT_API ttt_board ttt_board_play(ttt_board board, int cell, int side);
+/* Parses 9 characters ('X', 'O', anything else = empty); returns 0 on NULL/short input. */
+TTT_API int ttt_board_from_string(const char* cells, ttt_board* out);
+
+/* +10 (O has a line), -10 (X has a line) or 0. */
+TTT_API int ttt_evaluate(ttt_board board);
+/* One of TTT_X_WINS, TTT_DRAW, TTT_O_WINS, TTT_ONGOING, TTT_INVALID. */
+TTT_API int ttt_check_win(ttt_board board);
+
+/* Minimax value from O's point of view (wins sooner and losses later score
+ * better). is_max: O to move. */
+TTT_API int ttt_minimax(ttt_engine* engine, ttt_board board, int depth, int is_max);
+/* Best cell (0-8) for `side`, or -1 if the game is over or the board is invalid. */
+TTT_API int ttt_find_best_move(ttt_engine* engine, ttt_board board, int side);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTT_ENGINE_H */